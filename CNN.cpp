@@ -1,8 +1,13 @@
-#include "cnn.h"
+#include "CNN.h"
 
 #include <math.h>
 
+#include <algorithm>
+#include <fstream>
 #include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
 #include <vector>
 using namespace std;
 
@@ -22,17 +27,137 @@ structureData::structureData(int id, char type, int numFilters, int filterSize,
     mbias = bias;
 }
 
+/**
+ * @brief convolution window with the filter size and stride known at compile time so the window loops unroll.
+ * sums in the same order as convHelper so the result is identical
+ *
+ */
+template <int F, int S>
+long double convFixed(vector<vector<vector<long double>>>& input, vector<vector<long double>>& weights, int row,
+                      int col) {
+    long double dotprod = 0;
+    for (int z = 0; z < input.size(); z++) {
+        for (int i = 0; i < F; i++) {
+            const long double* in = input[z][(row * S) + i].data() + (col * S);
+            const long double* w = weights[i].data();
+            for (int j = 0; j < F; j++) {
+                dotprod += (in[j] * w[j]);
+            }
+        }
+    }
+    return dotprod;
+}
+
+/**
+ * @brief max pool window with the filter size and stride known at compile time
+ *
+ */
+template <int F, int S>
+long double maxFixed(vector<vector<vector<long double>>>& input, int c, int row, int col) {
+    long double curMax = input[c][row * S][col * S];
+    for (int i = 0; i < F; i++) {
+        const long double* in = input[c][(row * S) + i].data() + (col * S);
+        for (int j = 0; j < F; j++) {
+            if (in[j] > curMax) {
+                curMax = in[j];
+            }
+        }
+    }
+    return curMax;
+}
+
+/**
+ * @brief avg pool window with the filter size and stride known at compile time
+ *
+ */
+template <int F, int S>
+long double avgFixed(vector<vector<vector<long double>>>& input, int c, int row, int col) {
+    long double sum = 0.0;
+    for (int i = 0; i < F; i++) {
+        const long double* in = input[c][(row * S) + i].data() + (col * S);
+        for (int j = 0; j < F; j++) {
+            sum += in[j];
+        }
+    }
+    return (sum / (F * F));
+}
+
+struct convEntry {
+    int filterSize;
+    int stride;
+    convKernel kernel;
+};
+
+struct poolEntry {
+    int filterSize;
+    int stride;
+    poolKernel maxKernel;
+    poolKernel avgKernel;
+};
+
+#define CONV_ENTRY(F, S) {F, S, convFixed<F, S>},
+#define POOL_ENTRY(F, S) {F, S, maxFixed<F, S>, avgFixed<F, S>},
+static const convEntry convTable[] = {KERNEL_SHAPES(CONV_ENTRY)};
+static const poolEntry poolTable[] = {POOL_KERNEL_SHAPES(POOL_ENTRY)};
+#undef CONV_ENTRY
+#undef POOL_ENTRY
+
+convKernel findConvKernel(int filterSize, int stride) {
+    for (const convEntry& e : convTable) {
+        if (e.filterSize == filterSize && e.stride == stride) {
+            return e.kernel;
+        }
+    }
+    return nullptr;
+}
+
+static const poolEntry* findPoolEntry(int filterSize, int stride) {
+    for (const poolEntry& e : poolTable) {
+        if (e.filterSize == filterSize && e.stride == stride) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+poolKernel findMaxKernel(int filterSize, int stride) {
+    const poolEntry* e = findPoolEntry(filterSize, stride);
+    return e ? e->maxKernel : nullptr;
+}
+
+poolKernel findAvgKernel(int filterSize, int stride) {
+    const poolEntry* e = findPoolEntry(filterSize, stride);
+    return e ? e->avgKernel : nullptr;
+}
+
+/**
+ * @brief picks the sliding pooling engines. their horizontal pass touches every input cell whatever the stride, so
+ * they only pay off once each window rescans enough cells. measured on 3 channel 64x64 inputs (tests/pooling.cpp
+ * prints the timings) avg, which crosses over later than max, breaks even at about filter 6 for stride 1, 8 for
+ * stride 2, 10 for stride 3 and 13 for stride 4. the rule stays at or past each of those
+ *
+ */
+bool useSliding(int filterSize, int stride) { return filterSize >= (3 * stride) + 3; }
+
 Convolution::Convolution(int id, char type, int numFilters, int filterSize, int stride, int matrixDimension,
                          int channels, int activation, double bias)
-    : structureData(id, type, numFilters, filterSize, stride, matrixDimension, channels, activation, bias){};
+    : structureData(id, type, numFilters, filterSize, stride, matrixDimension, channels, activation, bias) {
+    mkernel = findConvKernel(filterSize, stride);
+};
 
 AvgPooling::AvgPooling(int id, char type, int numFilters, int filterSize, int stride, int matrixDimension, int channels,
                        int activation, double bias)
-    : structureData(id, type, numFilters, filterSize, stride, matrixDimension, channels, activation, bias){};
+    : structureData(id, type, numFilters, filterSize, stride, matrixDimension, channels, activation, bias) {
+    msliding = useSliding(filterSize, stride);
+    mkernel = msliding ? nullptr : findAvgKernel(filterSize, stride);
+};
 
 MaxPooling::MaxPooling(int id, char type, int numFilters, int filterSize, int stride, int matrixDimension, int channels,
                        int activation, double bias)
-    : structureData(id, type, numFilters, filterSize, stride, matrixDimension, channels, activation, bias){};
+    : structureData(id, type, numFilters, filterSize, stride, matrixDimension, channels, activation, bias) {
+    msliding = useSliding(filterSize, stride);
+    mkernel = msliding ? nullptr : findMaxKernel(filterSize, stride);
+};
 
 Input::Input(int id, char type, int numFilters, int filterSize, int stride, int matrixDimension, int channels,
              int activation, double bias)
@@ -75,9 +200,8 @@ void structureData::fullConWeights(int numWeights, vector<vector<long double>>&
  */
 Matrix Input::doTheThing(Matrix input) { return input; };
 
-long double Convolution::convHelper(int c, int row, int col, Matrix& input) {
+long double Convolution::convHelper(int c, int row, int col, vector<vector<vector<long double>>>& inputVec) {
     long double dotprod = 0;
-    vector<vector<vector<long double>>> inputVec = input.getVec();
     for (int z = 0; z < inputVec.size(); z++) {
         for (int i = row * mstride; i < mfilterSize + (row * mstride); i++) {
             for (int j = col * mstride; j < mfilterSize + (col * mstride); j++) {
@@ -96,7 +220,11 @@ Matrix Convolution::doTheThing(Matrix input) {
     for (int c = 0; c < dotVectors.size(); c++) {                // through channels
         for (int i = 0; i < dotVectors[c].size(); i++) {         // through resulting vectors rows
             for (int j = 0; j < dotVectors[c][i].size(); j++) {  // through the col
-                dotVectors[c][i][j] += convHelper(c, i, j, input);
+                if (mkernel) {
+                    dotVectors[c][i][j] += mkernel(inputVec, mWeights[c], i, j);
+                } else {
+                    dotVectors[c][i][j] += convHelper(c, i, j, inputVec);
+                }
             }
         }
     }
@@ -104,6 +232,41 @@ Matrix Convolution::doTheThing(Matrix input) {
     return output;
 }
 
+Matrix Convolution::backward(Matrix& input, Matrix& gradOutput, vector<vector<vector<long double>>>& gradWeights) {
+    vector<vector<vector<long double>>> inputVec = input.getVec();
+    vector<vector<vector<long double>>> grad = gradOutput.getVec();
+    int side = inputVec[0].size();
+
+    // the same filter slides over every input channel, so the filter only ever sees the channels summed together
+    vector<vector<long double>> channelSum(side, vector<long double>(side));
+    for (int z = 0; z < inputVec.size(); z++) {
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                channelSum[i][j] += inputVec[z][i][j];
+            }
+        }
+    }
+
+    vector<vector<long double>> spread(side, vector<long double>(side));
+    for (int c = 0; c < grad.size(); c++) {
+        for (int row = 0; row < grad[c].size(); row++) {
+            for (int col = 0; col < grad[c][row].size(); col++) {
+                long double g = grad[c][row][col];
+                for (int i = 0; i < mfilterSize; i++) {
+                    for (int j = 0; j < mfilterSize; j++) {
+                        gradWeights[c][i][j] += g * channelSum[(row * mstride) + i][(col * mstride) + j];
+                        spread[(row * mstride) + i][(col * mstride) + j] += g * mWeights[c][i][j];
+                    }
+                }
+            }
+        }
+    }
+
+    vector<vector<vector<long double>>> gradInput(inputVec.size(), spread);
+    Matrix output(gradInput);
+    return output;
+}
+
 /**
  * helper function to determine bounds
  * incremement by stride
@@ -124,6 +287,48 @@ long double AvgPooling::avgHelper(vector<vector<vector<long double>>>& input, in
     return result;
 }
 
+/**
+ * @brief sums of every strided window along a line from one prefix sum, outCount windows of width filterSize
+ *
+ */
+static void windowSums(vector<long double>& line, int filterSize, int stride, int outCount, vector<long double>& prefix,
+                       vector<long double>& out) {
+    int n = (outCount - 1) * stride + filterSize;
+    prefix[0] = 0.0;
+    for (int x = 0; x < n; x++) {
+        prefix[x + 1] = prefix[x] + line[x];
+    }
+    for (int k = 0; k < outCount; k++) {
+        out[k] = prefix[(k * stride) + filterSize] - prefix[k * stride];
+    }
+}
+
+void AvgPooling::avgSliding(vector<vector<vector<long double>>>& input, int chan, vector<vector<long double>>& result) {
+    int outSide = result.size();
+    int rows = (outSide - 1) * mstride + mfilterSize;
+    vector<long double> prefix(input[chan].size() + 1);
+    vector<long double> line;
+    vector<long double> sums(outSide);
+
+    // horizontal window sums for every input row any window touches
+    vector<vector<long double>> horizontal(rows, vector<long double>(outSide));
+    for (int i = 0; i < rows; i++) {
+        windowSums(input[chan][i], mfilterSize, mstride, outSide, prefix, horizontal[i]);
+    }
+
+    // then the vertical window sums of those, one column at a time
+    line.resize(rows);
+    for (int col = 0; col < outSide; col++) {
+        for (int i = 0; i < rows; i++) {
+            line[i] = horizontal[i][col];
+        }
+        windowSums(line, mfilterSize, mstride, outSide, prefix, sums);
+        for (int row = 0; row < outSide; row++) {
+            result[row][col] = (sums[row] / (mfilterSize * mfilterSize));
+        }
+    }
+}
+
 Matrix AvgPooling::doTheThing(Matrix input) {
     vector<vector<vector<long double>>> inputVec;
     inputVec = input.getVec();
@@ -131,9 +336,13 @@ Matrix AvgPooling::doTheThing(Matrix input) {
         mchannels, vector<vector<long double>>(mmatrixDimension, vector<long double>(mmatrixDimension)));
 
     for (int i = 0; i < mchannels; i++) {
+        if (msliding) {
+            avgSliding(inputVec, i, result[i]);
+            continue;
+        }
         for (int j = 0; j < result[i].size(); j++) {
             for (int z = 0; z < result[i][j].size(); z++) {
-                result[i][j][z] = avgHelper(inputVec, i, j, z);
+                result[i][j][z] = mkernel ? mkernel(inputVec, i, j, z) : avgHelper(inputVec, i, j, z);
             }
         }
     }
@@ -142,6 +351,29 @@ Matrix AvgPooling::doTheThing(Matrix input) {
     return output;
 }
 
+Matrix AvgPooling::backward(Matrix& input, Matrix& gradOutput, vector<vector<vector<long double>>>& gradWeights) {
+    vector<vector<vector<long double>>> inputVec = input.getVec();
+    vector<vector<vector<long double>>> grad = gradOutput.getVec();
+    vector<vector<vector<long double>>> gradInput(
+        inputVec.size(), vector<vector<long double>>(inputVec[0].size(), vector<long double>(inputVec[0].size())));
+
+    for (int c = 0; c < mchannels; c++) {
+        for (int row = 0; row < grad[c].size(); row++) {
+            for (int col = 0; col < grad[c][row].size(); col++) {
+                long double g = grad[c][row][col] / (mfilterSize * mfilterSize);
+                for (int i = row * mstride; i < mfilterSize + (row * mstride); i++) {
+                    for (int j = col * mstride; j < mfilterSize + (col * mstride); j++) {
+                        gradInput[c][i][j] += g;
+                    }
+                }
+            }
+        }
+    }
+
+    Matrix output(gradInput);
+    return output;
+}
+
 long double MaxPooling::maxHelper(vector<vector<vector<long double>>>& input, int c, int row, int col) {
     long double curMax = input[c][row * mstride][col * mstride];
 
@@ -156,6 +388,58 @@ long double MaxPooling::maxHelper(vector<vector<vector<long double>>>& input, in
     return curMax;
 }
 
+/**
+ * @brief van herk/gil-werman max of every strided window along a line. g holds the running max from the start of
+ * each block of filterSize values and h the running max to the end of it, so any window is max(h[x], g[x + f - 1])
+ *
+ */
+static void windowMax(vector<long double>& line, int filterSize, int stride, int outCount, vector<long double>& g,
+                      vector<long double>& h, vector<long double>& out) {
+    int n = (outCount - 1) * stride + filterSize;
+    for (int begin = 0; begin < n; begin += filterSize) {
+        int end = min(n, begin + filterSize);
+        g[begin] = line[begin];
+        for (int x = begin + 1; x < end; x++) {
+            g[x] = line[x] > g[x - 1] ? line[x] : g[x - 1];
+        }
+        h[end - 1] = line[end - 1];
+        for (int x = end - 2; x >= begin; x--) {
+            h[x] = line[x] > h[x + 1] ? line[x] : h[x + 1];
+        }
+    }
+    for (int k = 0; k < outCount; k++) {
+        long double left = h[k * stride];
+        long double right = g[(k * stride) + filterSize - 1];
+        out[k] = right > left ? right : left;
+    }
+}
+
+void MaxPooling::maxSliding(vector<vector<vector<long double>>>& input, int c, vector<vector<long double>>& result) {
+    int outSide = result.size();
+    int rows = (outSide - 1) * mstride + mfilterSize;
+    vector<long double> g(max<size_t>(input[c].size(), rows));
+    vector<long double> h(g.size());
+    vector<long double> line(rows);
+    vector<long double> maxes(outSide);
+
+    // horizontal window maxes for every input row any window touches
+    vector<vector<long double>> horizontal(rows, vector<long double>(outSide));
+    for (int i = 0; i < rows; i++) {
+        windowMax(input[c][i], mfilterSize, mstride, outSide, g, h, horizontal[i]);
+    }
+
+    // then the vertical window maxes of those, one column at a time
+    for (int col = 0; col < outSide; col++) {
+        for (int i = 0; i < rows; i++) {
+            line[i] = horizontal[i][col];
+        }
+        windowMax(line, mfilterSize, mstride, outSide, g, h, maxes);
+        for (int row = 0; row < outSide; row++) {
+            result[row][col] = maxes[row];
+        }
+    }
+}
+
 Matrix MaxPooling::doTheThing(Matrix input) {
     vector<vector<vector<long double>>> inputVec;
     inputVec = input.getVec();
@@ -163,9 +447,13 @@ Matrix MaxPooling::doTheThing(Matrix input) {
     vector<vector<vector<long double>>> result(
         mchannels, vector<vector<long double>>(mmatrixDimension, vector<long double>(mmatrixDimension)));
     for (int i = 0; i < mchannels; i++) {
+        if (msliding) {
+            maxSliding(inputVec, i, result[i]);
+            continue;
+        }
         for (int j = 0; j < result[i].size(); j++) {
             for (int z = 0; z < result[i][j].size(); z++) {
-                result[i][j][z] = maxHelper(inputVec, i, j, z);
+                result[i][j][z] = mkernel ? mkernel(inputVec, i, j, z) : maxHelper(inputVec, i, j, z);
             }
         }
     }
@@ -173,6 +461,35 @@ Matrix MaxPooling::doTheThing(Matrix input) {
     return output;
 }
 
+Matrix MaxPooling::backward(Matrix& input, Matrix& gradOutput, vector<vector<vector<long double>>>& gradWeights) {
+    vector<vector<vector<long double>>> inputVec = input.getVec();
+    vector<vector<vector<long double>>> grad = gradOutput.getVec();
+    vector<vector<vector<long double>>> gradInput(
+        inputVec.size(), vector<vector<long double>>(inputVec[0].size(), vector<long double>(inputVec[0].size())));
+
+    for (int c = 0; c < mchannels; c++) {
+        for (int row = 0; row < grad[c].size(); row++) {
+            for (int col = 0; col < grad[c][row].size(); col++) {
+                // same scan as maxHelper so ties go to the same cell
+                int maxRow = row * mstride;
+                int maxCol = col * mstride;
+                for (int i = row * mstride; i < mfilterSize + (row * mstride); i++) {
+                    for (int j = col * mstride; j < mfilterSize + (col * mstride); j++) {
+                        if (inputVec[c][i][j] > inputVec[c][maxRow][maxCol]) {
+                            maxRow = i;
+                            maxCol = j;
+                        }
+                    }
+                }
+                gradInput[c][maxRow][maxCol] += grad[c][row][col];
+            }
+        }
+    }
+
+    Matrix output(gradInput);
+    return output;
+}
+
 long double Connected::fullHelper(int count, int chan, int row, int col, vector<vector<vector<long double>>>& input) {
     // cout << "in helper" << endl;
     long double dotprod = 0.0;
@@ -204,6 +521,42 @@ Matrix Connected::doTheThing(Matrix input) {
     return output;
 }
 
+Matrix Connected::backward(Matrix& input, Matrix& gradOutput, vector<vector<vector<long double>>>& gradWeights) {
+    vector<vector<vector<long double>>> inputVec = input.getVec();
+    vector<vector<vector<long double>>> grad = gradOutput.getVec();
+    int side = inputVec[0].size();
+
+    // every input channel is multiplied by the same weight, like the filters in Convolution::backward
+    vector<vector<long double>> channelSum(side, vector<long double>(side));
+    for (int inchan = 0; inchan < inputVec.size(); inchan++) {
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                channelSum[i][j] += inputVec[inchan][i][j];
+            }
+        }
+    }
+
+    vector<vector<long double>> spread(side, vector<long double>(side));
+    for (int chan = 0; chan < grad.size(); chan++) {
+        for (int row = 0; row < grad[chan].size(); row++) {
+            for (int col = 0; col < grad[chan][row].size(); col++) {
+                long double g = grad[chan][row][col];
+                int out = col + (row * mmatrixDimension);
+                for (int i = 0; i < side; i++) {
+                    for (int j = 0; j < side; j++) {
+                        gradWeights[0][j + (i * side)][out] += g * channelSum[i][j];
+                        spread[i][j] += g * mWeights[chan][j + (i * side)][out];
+                    }
+                }
+            }
+        }
+    }
+
+    vector<vector<vector<long double>>> gradInput(inputVec.size(), spread);
+    Matrix output(gradInput);
+    return output;
+}
+
 Matrix CNN::makeF0(vector<long double>& input) {
     int size = sqrt(input.size());
     int iterator;
@@ -279,8 +632,81 @@ Matrix structureData::activation(Matrix input) {
     return output;
 }
 
-void CNN::run(vector<vector<long double>>& in, vector<vector<long double>>& flatWeights, vector<structureData*> data,
-              int iterations) {
+Matrix structureData::activationBackward(Matrix& output, Matrix& gradOutput) {
+    vector<vector<vector<long double>>> result = output.getVec();
+    vector<vector<vector<long double>>> grad = gradOutput.getVec();
+
+    for (int c = 0; c < result.size(); c++) {
+        for (int i = 0; i < result[c].size(); i++) {
+            for (int j = 0; j < result[c][i].size(); j++) {
+                long double y = result[c][i][j];
+                if (mactivation == 0) {  // sigmoid
+                    grad[c][i][j] *= y * (1 - y);
+                } else {  // tanh
+                    grad[c][i][j] *= 1 - (y * y);
+                }
+            }
+        }
+    }
+    Matrix gradInput(grad);
+    return gradInput;
+}
+
+/**
+ * @brief one sgd with momentum step on a 2d block of weights
+ *
+ */
+static void sgdStep(vector<vector<long double>>& weights, vector<vector<long double>>& velocity,
+                    vector<vector<long double>>& grad, long double rate, long double momentum) {
+    for (int i = 0; i < weights.size(); i++) {
+        for (int j = 0; j < weights[i].size(); j++) {
+            velocity[i][j] = (momentum * velocity[i][j]) - (rate * grad[i][j]);
+            weights[i][j] += velocity[i][j];
+        }
+    }
+}
+
+/**
+ * @brief zeroed copy of a 2d block of weights
+ *
+ */
+static vector<vector<long double>> zeroLike(vector<vector<long double>>& weights) {
+    vector<vector<long double>> zeros(weights.size());
+    for (int i = 0; i < weights.size(); i++) {
+        zeros[i].assign(weights[i].size(), 0);
+    }
+    return zeros;
+}
+
+void structureData::applyGradient(vector<vector<vector<long double>>>& gradWeights, long double gradBias,
+                                  long double rate, long double momentum) {
+    if (mVelocity.size() != mWeights.size()) {
+        mVelocity.clear();
+        for (int c = 0; c < mWeights.size(); c++) {
+            mVelocity.push_back(zeroLike(mWeights[c]));
+        }
+    }
+    for (int c = 0; c < mWeights.size(); c++) {
+        sgdStep(mWeights[c], mVelocity[c], gradWeights[c], rate, momentum);
+    }
+    mbiasVelocity = (momentum * mbiasVelocity) - (rate * gradBias);
+    mbias += mbiasVelocity;
+}
+
+void Connected::applyGradient(vector<vector<vector<long double>>>& gradWeights, long double gradBias, long double rate,
+                              long double momentum) {
+    if (mVelocity.empty()) {
+        mVelocity.push_back(zeroLike(mWeights[0]));
+    }
+    sgdStep(mWeights[0], mVelocity[0], gradWeights[0], rate, momentum);
+    for (int c = 1; c < mWeights.size(); c++) {
+        mWeights[c] = mWeights[0];
+    }
+    mbiasVelocity = (momentum * mbiasVelocity) - (rate * gradBias);
+    mbias += mbiasVelocity;
+}
+
+void CNN::loadWeights(vector<vector<long double>> flatWeights, vector<structureData*> data) {
     for (int i = 0; i < data.size(); i++) {
         if (data[i]->getType() == CONVOLUTION) {
             for (int j = 0; j < data[i]->getNumFilters(); j++) {
@@ -291,6 +717,11 @@ void CNN::run(vector<vector<long double>>& in, vector<vector<long double>>& flat
         }
         flatWeights.erase(flatWeights.begin(), flatWeights.begin() + data[i]->getNumFilters());
     }
+}
+
+void CNN::run(vector<vector<long double>>& in, vector<vector<long double>>& flatWeights, vector<structureData*> data,
+              int iterations) {
+    loadWeights(flatWeights, data);
 
     for (int iterations = 0; iterations < in.size(); iterations++) {
         Matrix input(makeF0(in[iterations]));
@@ -316,4 +747,207 @@ void CNN::run(vector<vector<long double>>& in, vector<vector<long double>>& flat
         input.DisplayInput(16);
         input.clear();
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief reads the input file and creates a vector of ints
+ *
+ * @param filename string
+ * @return vector<int>
+ */
+vector<vector<long double>> readInput(string filename) {
+    vector<vector<long double>> input;
+    vector<long double> cur;
+    ifstream file(filename, ios::in);
+
+    if (!file.is_open()) {
+        cerr << "Error: cannot open file" << filename << endl;
+        exit(1);
+    }
+
+    string line;
+
+    while (getline(file, line)) {
+        istringstream iss(line);
+        string word;
+        while (iss >> word) {
+            cur.push_back(stoi(word));
+        }
+        input.push_back(cur);
+        cur.clear();
+    }
+    return input;
+}
+
+/**
+ * @brief reads in the structure file and creates a vector of the data structure
+ *
+ * @param filename string
+ * @return vector<structureData>
+ */
+vector<structureData*> readStructure(string filename) {
+    vector<structureData*> sInput;
+    ifstream file(filename, ios::in);
+
+    if (!file.is_open()) {
+        cerr << "Error: cannot open file" << filename << endl;
+        exit(1);
+    }
+
+    string line;
+    while (getline(file, line)) {
+        istringstream iss(line);
+        string word;
+
+        iss >> word;
+        int id = stoi(word);
+
+        iss >> word;
+        char Ltype = word[0];
+
+        iss >> word;
+        int numfilters = stoi(word);
+
+        iss >> word;
+        int filtersize = stoi(word);
+
+        iss >> word;
+        int stride = stoi(word);
+
+        iss >> word;
+        int matrixDimension = stoi(word);
+
+        iss >> word;
+        int channels = stoi(word);
+
+        iss >> word;
+        int activation = stoi(word);
+
+        iss >> word;
+        double bias = stod(word);
+
+        switch (Ltype) {
+            case INPUT:
+                sInput.push_back(
+                    new Input(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels, activation, bias));
+                break;
+            case CONVOLUTION:
+                sInput.push_back(new Convolution(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels,
+                                                 activation, bias));
+                break;
+            case AVERAGE_POOLING:
+                sInput.push_back(new AvgPooling(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels,
+                                                activation, bias));
+                break;
+            case MAX_POOLING:
+                sInput.push_back(new MaxPooling(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels,
+                                                activation, bias));
+                break;
+            case FULLY_CONNECTED:
+                sInput.push_back(new Connected(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels,
+                                               activation, bias));
+                break;
+        }
+    }
+
+    return sInput;
+}
+
+/**
+ * @brief creates a vector of weights from the input file
+ *
+ * @param filename
+ * @return vector<vector<long double>>
+ */
+vector<vector<long double>> readWeights(string filename) {
+    vector<vector<long double>> weights;
+    vector<long double> cur;
+    vector<string> stringWeights;
+    ifstream file(filename, ios::in);
+
+    if (!file.is_open()) {
+        cerr << "Error: cannot open file" << filename << endl;
+        exit(1);
+    }
+
+    string line;
+    while (getline(file, line)) {
+        istringstream iss(line);
+        string word;
+        while (iss >> word) {
+            cur.push_back(stold(word));
+        }
+
+        weights.push_back(cur);
+        cur.clear();
+    }
+
+    return weights;
+}
+
+/**
+ * @brief writes the layers' current weights in the weight file format, laid out the same way loadWeights reads them
+ *
+ * @param filename
+ * @param flatWeights the weight file the layers were loaded from
+ * @param data
+ */
+void writeWeights(string filename, vector<vector<long double>> flatWeights, vector<structureData*> data) {
+    int cursor = 0;
+    for (int i = 0; i < data.size(); i++) {
+        vector<vector<vector<long double>>>& weights = data[i]->getWeights();
+        if (data[i]->getType() == CONVOLUTION) {
+            int size = data[i]->getFilterSize();
+            for (int f = 0; f < data[i]->getNumFilters(); f++) {
+                for (int r = 0; r < size; r++) {
+                    for (int c = 0; c < size; c++) {
+                        flatWeights[cursor + f][(r * size) + c] = weights[f][r][c];
+                    }
+                }
+            }
+        } else if (data[i]->getType() == FULLY_CONNECTED) {
+            for (int r = 0; r < weights[0].size(); r++) {
+                for (int c = 0; c < weights[0][r].size(); c++) {
+                    flatWeights[cursor + r][c] = weights[0][r][c];
+                }
+            }
+        }
+        cursor += data[i]->getNumFilters();
+    }
+
+    ofstream file(filename, ios::out);
+    if (!file.is_open()) {
+        cerr << "Error: cannot open file" << filename << endl;
+        exit(1);
+    }
+
+    // enough digits that readWeights gets back the exact same long double
+    file << setprecision(numeric_limits<long double>::max_digits10);
+    for (auto& row : flatWeights) {
+        for (int j = 0; j < row.size(); j++) {
+            file << (j == 0 ? "" : " ") << row[j];
+        }
+        file << endl;
+    }
+}
+
+/**
+ * @brief writes the structure file back out, the only field training changes is the bias
+ *
+ * @param filename
+ * @param data
+ */
+void writeStructure(string filename, vector<structureData*> data) {
+    ofstream file(filename, ios::out);
+    if (!file.is_open()) {
+        cerr << "Error: cannot open file" << filename << endl;
+        exit(1);
+    }
+
+    file << setprecision(numeric_limits<double>::max_digits10);
+    for (structureData* l : data) {
+        file << l->getId() << " " << (char)l->getType() << " " << l->getNumFilters() << " " << l->getFilterSize() << " "
+             << l->getStride() << " " << l->getside() << " " << l->getChannels() << " " << l->getActivation() << " "
+             << l->getBias() << endl;
+    }
+}
@@ -14,6 +14,7 @@
 
 #include <iomanip>
 #include <iostream>
+#include <string>
 #include <vector>
 
 using namespace std;
@@ -24,6 +25,27 @@ using namespace std;
  */
 enum { INPUT = 'I', CONVOLUTION = 'C', AVERAGE_POOLING = 'A', MAX_POOLING = 'M', FULLY_CONNECTED = 'F' };
 
+/**
+ * @brief window kernels with the filter size and stride baked in at compile time. layers pick one from a dispatch
+ * table when they are constructed and fall back to their generic helper when the shape is not in the table
+ *
+ */
+typedef long double (*convKernel)(vector<vector<vector<long double>>> &input, vector<vector<long double>> &weights,
+                                  int row, int col);
+typedef long double (*poolKernel)(vector<vector<vector<long double>>> &input, int c, int row, int col);
+
+// (filter size, stride) pairs that get a specialized convolution kernel, anything else uses convHelper
+#define KERNEL_SHAPES(X) X(1, 1) X(2, 1) X(2, 2) X(3, 1) X(3, 2) X(3, 3) X(4, 4) X(5, 1) X(5, 2) X(7, 1)
+// the same for pooling, minus the shapes useSliding hands to the sliding engines
+#define POOL_KERNEL_SHAPES(X) X(1, 1) X(2, 1) X(2, 2) X(3, 1) X(3, 2) X(3, 3) X(4, 4) X(5, 1) X(5, 2)
+
+// dispatch table lookups, nullptr when the shape has no specialized kernel
+convKernel findConvKernel(int filterSize, int stride);
+poolKernel findMaxKernel(int filterSize, int stride);
+poolKernel findAvgKernel(int filterSize, int stride);
+// true when a pooling layer of this shape uses maxSliding / avgSliding instead of a per window kernel
+bool useSliding(int filterSize, int stride);
+
 /**
  * @brief basic matrix class that has a 3d vector
  *
@@ -88,10 +110,45 @@ class structureData {
         return Matrix();
     };
 
+    /**
+     * @brief virtual backward pass shared between the children. takes the layer input and the gradient of the loss
+     * with respect to the layer output (before activation), adds the weight gradient into gradWeights and returns the
+     * gradient with respect to the input
+     *
+     * @param input
+     * @param gradOutput
+     * @param gradWeights shaped like the layer weights
+     * @return Matrix
+     */
+    virtual Matrix backward(Matrix &input, Matrix &gradOutput, vector<vector<vector<long double>>> &gradWeights) {
+        cerr << "NOT OVERIDED" << endl;
+        return Matrix();
+    };
+
+    /**
+     * @brief applies a minibatch gradient to the weights and bias with sgd and momentum
+     *
+     * @param gradWeights summed over the minibatch, shaped like the layer weights
+     * @param gradBias summed over the minibatch
+     * @param rate learning rate, already divided by the minibatch size
+     * @param momentum
+     */
+    virtual void applyGradient(vector<vector<vector<long double>>> &gradWeights, long double gradBias,
+                               long double rate, long double momentum);
+
     Matrix activation(Matrix input);
+    // turns the gradient wrt the activated output into the gradient wrt the output before activation
+    Matrix activationBackward(Matrix &output, Matrix &gradOutput);
+    vector<vector<vector<long double>>> &getWeights() { return mWeights; };
+    int getId() { return mid; };
     int getType() { return mtype; };
     int getNumFilters() { return mnumFilters; };
+    int getFilterSize() { return mfilterSize; };
+    int getStride() { return mstride; };
     int getside() { return mmatrixDimension; };
+    int getChannels() { return mchannels; };
+    int getActivation() { return mactivation; };
+    double getBias() { return mbias; };
 
     // this creates the weights and also formats them to be square
     void makeWeights(vector<long double> &a);
@@ -110,6 +167,9 @@ class structureData {
     int mactivation;
     double mbias;
     vector<vector<vector<long double>>> mWeights;
+    // momentum state for training, empty until the first applyGradient
+    vector<vector<vector<long double>>> mVelocity;
+    long double mbiasVelocity = 0;
 };
 
 /**
@@ -130,7 +190,7 @@ class Convolution : public structureData {
      * @param input
      * @return long double
      */
-    long double convHelper(int c, int row, int col, Matrix &input);
+    long double convHelper(int c, int row, int col, vector<vector<vector<long double>>> &input);
     void displayWeights();
     /**
      * @brief iterates the resulting matrix and populates each cell in the the 3d vector
@@ -139,6 +199,16 @@ class Convolution : public structureData {
      * @return Matrix
      */
     Matrix doTheThing(Matrix input) override;
+    /**
+     * @brief adds each filter's gradient and sends the output gradient back through the filters. every input
+     * channel sees the same filter so each one gets the same input gradient
+     *
+     */
+    Matrix backward(Matrix &input, Matrix &gradOutput, vector<vector<vector<long double>>> &gradWeights) override;
+
+   private:
+    // specialized kernel for this filter size and stride, nullptr when convHelper is used instead
+    convKernel mkernel;
 };
 
 /**
@@ -166,6 +236,26 @@ class MaxPooling : public structureData {
      * @return long double
      */
     long double maxHelper(vector<vector<vector<long double>>> &input, int c, int row, int col);
+    /**
+     * @brief fills one output channel with a separable van herk/gil-werman running max, the cost per output cell
+     * does not depend on the filter size
+     *
+     * @param input
+     * @param c
+     * @param result
+     */
+    void maxSliding(vector<vector<vector<long double>>> &input, int c, vector<vector<long double>> &result);
+    /**
+     * @brief routes each output gradient to the input cell maxHelper picked for that window
+     *
+     */
+    Matrix backward(Matrix &input, Matrix &gradOutput, vector<vector<vector<long double>>> &gradWeights) override;
+
+   private:
+    // specialized kernel for this filter size and stride, nullptr when maxHelper is used instead
+    poolKernel mkernel;
+    // true when useSliding found maxSliding faster than rescanning every window for this shape
+    bool msliding;
 };
 
 /**
@@ -193,6 +283,26 @@ class AvgPooling : public structureData {
      * @return long double
      */
     long double avgHelper(vector<vector<vector<long double>>> &input, int chan, int rows, int col);
+    /**
+     * @brief fills one output channel from separable prefix sums, the cost per output cell does not depend on the
+     * filter size. can differ from avgHelper in the last bits since the sums are taken in a different order
+     *
+     * @param input
+     * @param chan
+     * @param result
+     */
+    void avgSliding(vector<vector<vector<long double>>> &input, int chan, vector<vector<long double>> &result);
+    /**
+     * @brief spreads each output gradient evenly over its window
+     *
+     */
+    Matrix backward(Matrix &input, Matrix &gradOutput, vector<vector<vector<long double>>> &gradWeights) override;
+
+   private:
+    // specialized kernel for this filter size and stride, nullptr when avgHelper is used instead
+    poolKernel mkernel;
+    // true when useSliding found avgSliding faster than rescanning every window for this shape
+    bool msliding;
 };
 
 /**
@@ -233,6 +343,15 @@ class Connected : public structureData {
      * @return Matrix
      */
     Matrix doTheThing(Matrix input) override;
+    /**
+     * @brief every output channel shares one set of weights (see fullConWeights) so the weight gradient is summed
+     * into gradWeights[0] only
+     *
+     */
+    Matrix backward(Matrix &input, Matrix &gradOutput, vector<vector<vector<long double>>> &gradWeights) override;
+    // updates the shared weights and copies them back to every channel
+    void applyGradient(vector<vector<vector<long double>>> &gradWeights, long double gradBias, long double rate,
+                       long double momentum) override;
 };
 
 /**
@@ -246,6 +365,8 @@ class CNN {
     CNN(vector<structureData *> Data) { mData = Data; };
     // creates our input matrix
     Matrix makeF0(vector<long double> &input);
+    // hands each layer its rows of the weight file
+    void loadWeights(vector<vector<long double>> flatWeights, vector<structureData *> data);
 
     // Matrix getInput() { return mInput.getVec(); };
     void run(vector<vector<long double>> &in, vector<vector<long double>> &flatWeights, vector<structureData *> data,
@@ -255,4 +376,12 @@ class CNN {
     vector<structureData *> mData;
 };
 
+// readers for the input, weight and structure text files
+vector<vector<long double>> readInput(string filename);
+vector<structureData *> readStructure(string filename);
+vector<vector<long double>> readWeights(string filename);
+// writers for checkpoints, flatWeights is the weight file the layers were loaded from so unused values carry over
+void writeWeights(string filename, vector<vector<long double>> flatWeights, vector<structureData *> data);
+void writeStructure(string filename, vector<structureData *> data);
+
 #endif
\ No newline at end of file
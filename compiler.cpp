@@ -0,0 +1,648 @@
+/**
+ * @file compiler.cpp
+ * @author Keoni Burns
+ * @brief ahead of time model compiler. reads a structure file (and optionally a weight file) and writes a standalone
+ * c++ translation unit where every shape, stride, layer and activation is a compile time constant
+ *
+ * build:  g++ -O2 -o cnnc compiler.cpp CNN.cpp
+ * usage:  ./cnnc structure [weights] [-o out.cpp] [--header out.h] [--name model] [--main]
+ *
+ * when a weight file is given the weights are embedded as constexpr arrays, otherwise the generated code gets a
+ * loadWeights() function that reads the usual weight file at runtime. --main adds a main() that takes the same
+ * arguments and prints in the same format as the interpreted CNN::run path. the generated pooling rescans every
+ * window, so results are bit identical to CNN::run except after an avg pooling layer that useSliding hands to
+ * avgSliding, where the last bits can differ. tests/compiler.cpp checks both
+ *
+ * to use the model as a library pass --header, which writes the declarations of run(), loadWeights() and the shape
+ * constants to that file and has the generated code include it:
+ *
+ *     ./cnnc model.structure model.weights -o model.cpp --header model.h
+ *     g++ -O2 -c model.cpp && ar rcs libmodel.a model.o
+ *
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CNN.h"
+
+using namespace std;
+
+/**
+ * @brief shape and weight slot of one layer after walking the structure file
+ *
+ */
+struct layerPlan {
+    structureData *layer;
+    int inChannels;
+    int inSide;
+    int outChannels;
+    int outSide;
+    int weightRow;   // first row of the weight file this layer reads
+    int weightRows;  // number of rows it reads
+    int weightCols;  // number of values it reads from each row
+};
+
+/**
+ * @brief prints the error and stops, the compiler has nothing useful to emit after a bad structure
+ *
+ * @param message
+ */
+void fail(string message) {
+    cerr << "Error: " << message << endl;
+    exit(1);
+}
+
+/**
+ * @brief formats a long double as an exact hex literal
+ *
+ * @param value
+ * @return string
+ */
+string literal(long double value) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%LaL", value);
+    return buf;
+}
+
+/**
+ * @brief formats a double as an exact hex literal, the bias is a double in the interpreted path
+ *
+ * @param value
+ * @return string
+ */
+string literal(double value) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%a", value);
+    return buf;
+}
+
+/**
+ * @brief checks that the model name can be used as the generated namespace
+ *
+ * @param name
+ * @return true
+ * @return false
+ */
+bool validName(string name) {
+    static const vector<string> keywords = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+        "char", "char8_t", "char16_t", "char32_t", "class", "compl", "concept", "const", "consteval", "constexpr",
+        "constinit", "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype", "default", "delete",
+        "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for",
+        "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq",
+        "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register", "reinterpret_cast",
+        "requires", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct",
+        "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union",
+        "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq", "std"};
+
+    if (name.empty() || isdigit((unsigned char)name[0])) {
+        return false;
+    }
+    for (char ch : name) {
+        if (!isalnum((unsigned char)ch) && ch != '_') {
+            return false;
+        }
+    }
+    for (const string &keyword : keywords) {
+        if (name == keyword) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief walks the structure the same way CNN::run does and works out every layer's shapes and weight rows
+ *
+ * @param data
+ * @return vector<layerPlan>
+ */
+vector<layerPlan> plan(vector<structureData *> &data) {
+    vector<layerPlan> plans;
+    if (data.empty() || data[0]->getType() != INPUT) {
+        fail("the first layer must be the input layer");
+    }
+
+    int channels = 1;
+    int side = data[0]->getside();
+    int cursor = 0;
+    for (int i = 0; i < data.size(); i++) {
+        structureData *l = data[i];
+        layerPlan p = {l, channels, side, channels, side, cursor, 0, 0};
+        int f = l->getFilterSize();
+        int s = l->getStride();
+
+        switch (l->getType()) {
+            case INPUT:
+                if (i != 0) {
+                    fail("layer " + to_string(l->getId()) + ": the input layer must only appear first");
+                }
+                break;
+            case CONVOLUTION:
+                p.outChannels = l->getNumFilters();
+                p.outSide = l->getside();
+                p.weightRows = l->getNumFilters();
+                p.weightCols = f * f;
+                break;
+            case AVERAGE_POOLING:
+            case MAX_POOLING:
+                if (l->getChannels() > channels) {
+                    fail("layer " + to_string(l->getId()) + ": pools more channels than its input has");
+                }
+                p.outChannels = l->getChannels();
+                p.outSide = l->getside();
+                break;
+            case FULLY_CONNECTED:
+                // every output channel shares the same weights, see structureData::fullConWeights
+                p.outChannels = l->getChannels();
+                p.outSide = l->getside();
+                p.weightRows = data[i - 1]->getside() * data[i - 1]->getside();
+                p.weightCols = p.outSide * p.outSide;
+                if (side * side > p.weightRows) {
+                    fail("layer " + to_string(l->getId()) + ": input is larger than the previous layer's dimension");
+                }
+                break;
+        }
+
+        if (l->getType() == CONVOLUTION || l->getType() == AVERAGE_POOLING || l->getType() == MAX_POOLING) {
+            if (f <= 0 || s <= 0 || (p.outSide - 1) * s + f > side) {
+                fail("layer " + to_string(l->getId()) + ": filter window runs past the input");
+            }
+        }
+        if (l->getType() != INPUT && l->getType() != AVERAGE_POOLING && l->getType() != MAX_POOLING &&
+            l->getActivation() != 0 && l->getActivation() != 1) {
+            cerr << "warning: layer " << l->getId() << " has an invalid activation type, using tanh like CNN::run"
+                 << endl;
+        }
+
+        cursor += l->getNumFilters();
+        channels = p.outChannels;
+        side = p.outSide;
+        plans.push_back(p);
+    }
+    return plans;
+}
+
+/**
+ * @brief writes the weight array declaration for one layer, embedded when weights were given
+ *
+ * @param out
+ * @param p
+ * @param index
+ * @param weights
+ * @param embed
+ */
+void emitWeights(ostream &out, layerPlan &p, int index, vector<vector<long double>> &weights, bool embed) {
+    int type = p.layer->getType();
+    if (type != CONVOLUTION && type != FULLY_CONNECTED) {
+        return;
+    }
+
+    string dims;
+    if (type == CONVOLUTION) {
+        int f = p.layer->getFilterSize();
+        dims = "[" + to_string(p.weightRows) + "][" + to_string(f) + "][" + to_string(f) + "]";
+    } else {
+        dims = "[" + to_string(p.weightRows) + "][" + to_string(p.weightCols) + "]";
+    }
+
+    if (!embed) {
+        out << "static long double w" << index << dims << ";\n";
+        return;
+    }
+
+    out << "constexpr long double w" << index << dims << " = {\n";
+    for (int r = 0; r < p.weightRows; r++) {
+        int row = p.weightRow + r;
+        if (row >= weights.size() || weights[row].size() < p.weightCols) {
+            fail("weight file is missing values for layer " + to_string(p.layer->getId()));
+        }
+        out << "    {";
+        int f = p.layer->getFilterSize();
+        for (int c = 0; c < p.weightCols; c++) {
+            if (type == CONVOLUTION && c % f == 0) {
+                out << (c == 0 ? "{" : "}, {");
+            } else if (c != 0) {
+                out << ", ";
+            }
+            out << literal(weights[row][c]);
+        }
+        out << (type == CONVOLUTION ? "}},\n" : "},\n");
+    }
+    out << "};\n";
+}
+
+/**
+ * @brief writes the activation applied in place to a layer's output, same arithmetic as structureData::activation
+ *
+ * @param out
+ * @param p
+ * @param buffer
+ */
+void emitActivation(ostream &out, layerPlan &p, string buffer) {
+    out << "    for (int c = 0; c < " << p.outChannels << "; c++) {\n";
+    out << "        for (int i = 0; i < " << p.outSide << "; i++) {\n";
+    out << "            for (int j = 0; j < " << p.outSide << "; j++) {\n";
+    out << "                long double tmp = " << literal(p.layer->getBias()) << " + " << buffer << "[c][i][j];\n";
+    if (p.layer->getActivation() == 0) {
+        out << "                " << buffer << "[c][i][j] = (1 / (1 + std::exp(-tmp)));\n";
+    } else {
+        out << "                " << buffer
+            << "[c][i][j] = ((std::exp(tmp) - std::exp(-tmp)) / (std::exp(tmp) + std::exp(-tmp)));\n";
+    }
+    out << "            }\n";
+    out << "        }\n";
+    out << "    }\n";
+}
+
+/**
+ * @brief writes the function that computes one layer from the previous layer's buffer
+ *
+ * @param out
+ * @param p
+ * @param index
+ */
+void emitLayer(ostream &out, layerPlan &p, int index) {
+    int f = p.layer->getFilterSize();
+    int s = p.layer->getStride();
+    string in = "l" + to_string(index - 1);
+    string res = "l" + to_string(index);
+
+    out << "static inline void layer" << index << "() {\n";
+    switch (p.layer->getType()) {
+        case CONVOLUTION:
+            out << "    for (int c = 0; c < " << p.outChannels << "; c++) {\n";
+            out << "        for (int row = 0; row < " << p.outSide << "; row++) {\n";
+            out << "            for (int col = 0; col < " << p.outSide << "; col++) {\n";
+            out << "                long double dotprod = 0;\n";
+            out << "                for (int z = 0; z < " << p.inChannels << "; z++) {\n";
+            out << "                    for (int i = 0; i < " << f << "; i++) {\n";
+            out << "                        for (int j = 0; j < " << f << "; j++) {\n";
+            out << "                            dotprod += (" << in << "[z][(row * " << s << ") + i][(col * " << s
+                << ") + j] * w" << index << "[c][i][j]);\n";
+            out << "                        }\n";
+            out << "                    }\n";
+            out << "                }\n";
+            out << "                " << res << "[c][row][col] = 0;\n";
+            out << "                " << res << "[c][row][col] += dotprod;\n";
+            out << "            }\n";
+            out << "        }\n";
+            out << "    }\n";
+            emitActivation(out, p, res);
+            break;
+        case MAX_POOLING:
+            out << "    for (int c = 0; c < " << p.outChannels << "; c++) {\n";
+            out << "        for (int row = 0; row < " << p.outSide << "; row++) {\n";
+            out << "            for (int col = 0; col < " << p.outSide << "; col++) {\n";
+            out << "                long double curMax = " << in << "[c][row * " << s << "][col * " << s << "];\n";
+            out << "                for (int i = 0; i < " << f << "; i++) {\n";
+            out << "                    for (int j = 0; j < " << f << "; j++) {\n";
+            out << "                        long double v = " << in << "[c][(row * " << s << ") + i][(col * " << s
+                << ") + j];\n";
+            out << "                        if (v > curMax) {\n";
+            out << "                            curMax = v;\n";
+            out << "                        }\n";
+            out << "                    }\n";
+            out << "                }\n";
+            out << "                " << res << "[c][row][col] = curMax;\n";
+            out << "            }\n";
+            out << "        }\n";
+            out << "    }\n";
+            break;
+        case AVERAGE_POOLING:
+            out << "    for (int c = 0; c < " << p.outChannels << "; c++) {\n";
+            out << "        for (int row = 0; row < " << p.outSide << "; row++) {\n";
+            out << "            for (int col = 0; col < " << p.outSide << "; col++) {\n";
+            out << "                long double sum = 0.0;\n";
+            out << "                for (int i = 0; i < " << f << "; i++) {\n";
+            out << "                    for (int j = 0; j < " << f << "; j++) {\n";
+            out << "                        sum += " << in << "[c][(row * " << s << ") + i][(col * " << s
+                << ") + j];\n";
+            out << "                    }\n";
+            out << "                }\n";
+            out << "                " << res << "[c][row][col] = (sum / " << f * f << ");\n";
+            out << "            }\n";
+            out << "        }\n";
+            out << "    }\n";
+            break;
+        case FULLY_CONNECTED:
+            out << "    for (int c = 0; c < " << p.outChannels << "; c++) {\n";
+            out << "        for (int row = 0; row < " << p.outSide << "; row++) {\n";
+            out << "            for (int col = 0; col < " << p.outSide << "; col++) {\n";
+            out << "                long double dotprod = 0.0;\n";
+            out << "                for (int z = 0; z < " << p.inChannels << "; z++) {\n";
+            out << "                    for (int i = 0; i < " << p.inSide << "; i++) {\n";
+            out << "                        for (int j = 0; j < " << p.inSide << "; j++) {\n";
+            out << "                            dotprod += (" << in << "[z][i][j] * w" << index << "[j + (i * "
+                << p.inSide << ")][col + (row * " << p.outSide << ")]);\n";
+            out << "                        }\n";
+            out << "                    }\n";
+            out << "                }\n";
+            out << "                " << res << "[c][row][col] = 0;\n";
+            out << "                " << res << "[c][row][col] += dotprod;\n";
+            out << "            }\n";
+            out << "        }\n";
+            out << "    }\n";
+            emitActivation(out, p, res);
+            break;
+    }
+    out << "}\n\n";
+}
+
+/**
+ * @brief writes loadWeights(), which fills the weight arrays from a weight file the same way CNN::run does
+ *
+ * @param out
+ * @param plans
+ */
+void emitLoader(ostream &out, vector<layerPlan> &plans) {
+    out << "bool loadWeights(const char *filename) {\n";
+    out << "    std::ifstream file(filename, std::ios::in);\n";
+    out << "    if (!file.is_open()) {\n";
+    out << "        return false;\n";
+    out << "    }\n";
+    out << "    std::vector<std::vector<long double>> rows;\n";
+    out << "    std::string line;\n";
+    out << "    while (std::getline(file, line)) {\n";
+    out << "        std::istringstream iss(line);\n";
+    out << "        std::string word;\n";
+    out << "        rows.emplace_back();\n";
+    out << "        while (iss >> word) {\n";
+    out << "            rows.back().push_back(std::stold(word));\n";
+    out << "        }\n";
+    out << "    }\n";
+    for (int i = 0; i < plans.size(); i++) {
+        layerPlan &p = plans[i];
+        if (p.weightRows == 0) {
+            continue;
+        }
+        out << "    for (size_t r = 0; r < " << p.weightRows << "; r++) {\n";
+        out << "        if (" << p.weightRow << " + r >= rows.size() || rows[" << p.weightRow << " + r].size() < "
+            << p.weightCols << ") {\n";
+        out << "            return false;\n";
+        out << "        }\n";
+        out << "        for (int k = 0; k < " << p.weightCols << "; k++) {\n";
+        if (p.layer->getType() == CONVOLUTION) {
+            int f = p.layer->getFilterSize();
+            out << "            w" << i << "[r][k / " << f << "][k % " << f << "] = rows[" << p.weightRow
+                << " + r][k];\n";
+        } else {
+            out << "            w" << i << "[r][k] = rows[" << p.weightRow << " + r][k];\n";
+        }
+        out << "        }\n";
+        out << "    }\n";
+    }
+    out << "    return true;\n";
+    out << "}\n\n";
+}
+
+/**
+ * @brief writes a main() with the same arguments and output format as the interpreted driver
+ *
+ * @param out
+ * @param name
+ * @param embed
+ */
+void emitMain(ostream &out, string name, bool embed) {
+    out << "int main(int argc, char **argv) {\n";
+    out << "    if (argc < " << (embed ? 2 : 3) << ") {\n";
+    out << "        std::cerr << \"usage: \" << argv[0] << \" input" << (embed ? "" : " weights") << "\" << std::endl;\n";
+    out << "        return 1;\n";
+    out << "    }\n";
+    if (!embed) {
+        out << "    if (!" << name << "::loadWeights(argv[2])) {\n";
+        out << "        std::cerr << \"Error: cannot load weights \" << argv[2] << std::endl;\n";
+        out << "        return 1;\n";
+        out << "    }\n";
+    }
+    out << "    std::ifstream file(argv[1], std::ios::in);\n";
+    out << "    if (!file.is_open()) {\n";
+    out << "        std::cerr << \"Error: cannot open file\" << argv[1] << std::endl;\n";
+    out << "        return 1;\n";
+    out << "    }\n";
+    out << "    std::cout << std::showpoint << std::fixed << std::setprecision(16);\n";
+    out << "    std::string line;\n";
+    out << "    while (std::getline(file, line)) {\n";
+    out << "        std::istringstream iss(line);\n";
+    out << "        std::string word;\n";
+    out << "        std::vector<long double> cur;\n";
+    out << "        while (iss >> word) {\n";
+    out << "            cur.push_back(std::stoi(word));\n";
+    out << "        }\n";
+    out << "        if (cur.size() != " << name << "::kInputSide * " << name << "::kInputSide) {\n";
+    out << "            std::cerr << \"Error: input line has the wrong number of values\" << std::endl;\n";
+    out << "            return 1;\n";
+    out << "        }\n";
+    out << "        long double output[" << name << "::kOutputChannels][" << name << "::kOutputSide][" << name
+        << "::kOutputSide];\n";
+    out << "        " << name << "::run(cur.data(), output);\n";
+    out << "        for (auto &channel : output) {\n";
+    out << "            for (auto &row : channel) {\n";
+    out << "                for (auto &col : row) {\n";
+    out << "                    std::cout << col << \" \";\n";
+    out << "                }\n";
+    out << "            }\n";
+    out << "            std::cout << std::endl;\n";
+    out << "        }\n";
+    out << "    }\n";
+    out << "    return 0;\n";
+    out << "}\n";
+}
+
+/**
+ * @brief writes the shape constants shared by the header and the translation unit
+ *
+ * @param out
+ * @param plans
+ */
+void emitConstants(ostream &out, vector<layerPlan> &plans) {
+    layerPlan &last = plans.back();
+    out << "constexpr int kInputSide = " << plans[0].outSide << ";\n";
+    out << "constexpr int kOutputChannels = " << last.outChannels << ";\n";
+    out << "constexpr int kOutputSide = " << last.outSide << ";\n\n";
+}
+
+/**
+ * @brief writes the header a library build includes to call the generated model
+ *
+ * @param out
+ * @param plans
+ * @param embed
+ * @param name
+ * @param source
+ */
+void emitHeader(ostream &out, vector<layerPlan> &plans, bool embed, string name, string source) {
+    string guard;
+    for (char ch : name) {
+        guard += toupper((unsigned char)ch);
+    }
+    guard += "_MODEL_H";
+
+    out << "// generated by cnnc from " << source << ", do not edit\n\n";
+    out << "#ifndef " << guard << "\n";
+    out << "#define " << guard << "\n\n";
+    out << "namespace " << name << " {\n\n";
+    emitConstants(out, plans);
+    if (!embed) {
+        out << "// fills the weights from a weight file, returns false if it is missing values\n";
+        out << "bool loadWeights(const char *filename);\n\n";
+    }
+    out << "// input is one image flattened row by row, like a line of the input file\n";
+    out << "void run(const long double *input, long double (&output)[kOutputChannels][kOutputSide][kOutputSide]);\n\n";
+    out << "}  // namespace " << name << "\n\n";
+    out << "#endif\n";
+}
+
+/**
+ * @brief writes the whole translation unit
+ *
+ * @param out
+ * @param plans
+ * @param weights
+ * @param embed
+ * @param name
+ * @param withMain
+ * @param source
+ * @param header include path of the generated header, empty when there is none
+ */
+void emitProgram(ostream &out, vector<layerPlan> &plans, vector<vector<long double>> &weights, bool embed,
+                 string name, bool withMain, string source, string header) {
+    out << "// generated by cnnc from " << source << ", do not edit\n";
+    out << "// build with -O2 or higher, and without -ffast-math so results match CNN::run\n\n";
+    out << "#include <cmath>\n";
+    out << "#include <fstream>\n";
+    out << "#include <iomanip>\n";
+    out << "#include <iostream>\n";
+    out << "#include <sstream>\n";
+    out << "#include <string>\n";
+    out << "#include <vector>\n\n";
+    if (!header.empty()) {
+        out << "#include \"" << header << "\"\n\n";
+    }
+    out << "namespace " << name << " {\n\n";
+    if (header.empty()) {
+        emitConstants(out, plans);
+    }
+
+    for (int i = 0; i < plans.size(); i++) {
+        emitWeights(out, plans[i], i, weights, embed);
+    }
+    out << "\n";
+    // one thread_local buffer per layer keeps large models off the stack and run() safe to call from many threads
+    for (int i = 0; i < plans.size(); i++) {
+        out << "static thread_local long double l" << i << "[" << plans[i].outChannels << "][" << plans[i].outSide
+            << "][" << plans[i].outSide << "];\n";
+    }
+    out << "\n";
+
+    for (int i = 1; i < plans.size(); i++) {
+        emitLayer(out, plans[i], i);
+    }
+    if (!embed) {
+        emitLoader(out, plans);
+    }
+
+    out << "// input is one image flattened row by row, like a line of the input file\n";
+    out << "void run(const long double *input, long double (&output)[kOutputChannels][kOutputSide][kOutputSide]) {\n";
+    out << "    for (int i = 0; i < kInputSide; i++) {\n";
+    out << "        for (int j = 0; j < kInputSide; j++) {\n";
+    out << "            l0[0][i][j] = input[j + (i * kInputSide)];\n";
+    out << "        }\n";
+    out << "    }\n";
+    for (int i = 1; i < plans.size(); i++) {
+        out << "    layer" << i << "();\n";
+    }
+    int n = plans.size() - 1;
+    out << "    for (int c = 0; c < kOutputChannels; c++) {\n";
+    out << "        for (int i = 0; i < kOutputSide; i++) {\n";
+    out << "            for (int j = 0; j < kOutputSide; j++) {\n";
+    out << "                output[c][i][j] = l" << n << "[c][i][j];\n";
+    out << "            }\n";
+    out << "        }\n";
+    out << "    }\n";
+    out << "}\n\n";
+    out << "}  // namespace " << name << "\n";
+
+    if (withMain) {
+        out << "\n";
+        emitMain(out, name, embed);
+    }
+}
+
+/**
+ * @brief driver function
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char **argv) {
+    vector<string> files;
+    string output;
+    string header;
+    string name = "model";
+    bool withMain = false;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--header" && i + 1 < argc) {
+            header = argv[++i];
+        } else if (arg == "--name" && i + 1 < argc) {
+            name = argv[++i];
+        } else if (arg == "--main") {
+            withMain = true;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty() || files.size() > 2) {
+        cerr << "usage: " << argv[0] << " structure [weights] [-o out.cpp] [--header out.h] [--name model] [--main]"
+             << endl;
+        return 1;
+    }
+    if (!validName(name)) {
+        cerr << "Error: --name must be a c++ identifier that is not a keyword, got " << name << endl;
+        return 1;
+    }
+
+    vector<structureData *> data = readStructure(files[0]);
+    vector<vector<long double>> weights;
+    bool embed = files.size() == 2;
+    if (embed) {
+        weights = readWeights(files[1]);
+    }
+    vector<layerPlan> plans = plan(data);
+
+    // the translation unit includes the header by its file name, so keep the two side by side
+    string include = header.substr(header.find_last_of('/') + 1);
+    if (!header.empty()) {
+        ofstream file(header, ios::out);
+        if (!file.is_open()) {
+            cerr << "Error: cannot open file" << header << endl;
+            return 1;
+        }
+        emitHeader(file, plans, embed, name, files[0]);
+    }
+
+    if (output.empty()) {
+        emitProgram(cout, plans, weights, embed, name, withMain, files[0], include);
+    } else {
+        ofstream file(output, ios::out);
+        if (!file.is_open()) {
+            cerr << "Error: cannot open file" << output << endl;
+            return 1;
+        }
+        emitProgram(file, plans, weights, embed, name, withMain, files[0], include);
+    }
+    return 0;
+}
@@ -10,153 +10,64 @@
 
 #include <math.h>
 
-#include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <map>
-#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
-#include "cnn.h"
+#include "CNN.h"
+#include "trainer.h"
 
 using namespace std;
-/**
- * @brief reads the input file and creates a vector of ints
- *
- * @param filename string
- * @return vector<int>
- */
-vector<vector<long double>> readInput(string filename) {
-    vector<vector<long double>> input;
-    vector<long double> cur;
-    ifstream file(filename, ios::in);
-
-    if (!file.is_open()) {
-        cerr << "Error: cannot open file" << filename << endl;
-        exit(1);
-    }
-
-    string line;
-
-    while (getline(file, line)) {
-        istringstream iss(line);
-        string word;
-        while (iss >> word) {
-            cur.push_back(stoi(word));
-        }
-        input.push_back(cur);
-        cur.clear();
-    }
-    return input;
-}
 
 /**
- * @brief reads in the structure file and creates a vector of the data structure
+ * @brief training mode, fine tunes the weights against a target file and writes a checkpoint after every epoch
  *
- * @param filename string
- * @return vector<structureData>
- */
-vector<structureData*> readStructure(string filename) {
-    vector<structureData*> sInput;
-    ifstream file(filename, ios::in);
-
-    if (!file.is_open()) {
-        cerr << "Error: cannot open file" << filename << endl;
-        exit(1);
-    }
-
-    string line;
-    while (getline(file, line)) {
-        istringstream iss(line);
-        string word;
-
-        iss >> word;
-        int id = stoi(word);
-
-        iss >> word;
-        char Ltype = word[0];
-
-        iss >> word;
-        int numfilters = stoi(word);
-
-        iss >> word;
-        int filtersize = stoi(word);
-
-        iss >> word;
-        int stride = stoi(word);
-
-        iss >> word;
-        int matrixDimension = stoi(word);
-
-        iss >> word;
-        int channels = stoi(word);
-
-        iss >> word;
-        int activation = stoi(word);
-
-        iss >> word;
-        double bias = stod(word);
-
-        switch (Ltype) {
-            case INPUT:
-                sInput.push_back(
-                    new Input(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels, activation, bias));
-                break;
-            case CONVOLUTION:
-                sInput.push_back(new Convolution(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels,
-                                                 activation, bias));
-                break;
-            case AVERAGE_POOLING:
-                sInput.push_back(new AvgPooling(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels,
-                                                activation, bias));
-                break;
-            case MAX_POOLING:
-                sInput.push_back(new MaxPooling(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels,
-                                                activation, bias));
-                break;
-            case FULLY_CONNECTED:
-                sInput.push_back(new Connected(id, Ltype, numfilters, filtersize, stride, matrixDimension, channels,
-                                               activation, bias));
-                break;
-        }
-    }
-
-    return sInput;
-}
-
-/**
- * @brief creates a vector of weights from the input file
+ * usage: --train input targets weights structure checkpoint [epochs] [batch size] [rate] [momentum] [threads]
+ * the checkpoint is written as checkpoint.weights and checkpoint.structure, which the normal mode reads back
  *
- * @param filename
- * @return vector<vector<long double>>
+ * @param argc
+ * @param argv
+ * @return int
  */
-vector<vector<long double>> readWeights(string filename) {
-    vector<vector<long double>> weights;
-    vector<long double> cur;
-    vector<string> stringWeights;
-    ifstream file(filename, ios::in);
-
-    if (!file.is_open()) {
-        cerr << "Error: cannot open file" << filename << endl;
-        exit(1);
+int train(int argc, char** argv) {
+    if (argc < 7) {
+        cerr << "usage: " << argv[0]
+             << " --train input targets weights structure checkpoint [epochs] [batch size] [rate] [momentum] [threads]"
+             << endl;
+        return 1;
     }
-
-    string line;
-    while (getline(file, line)) {
-        istringstream iss(line);
-        string word;
-        while (iss >> word) {
-            cur.push_back(stold(word));
-        }
-
-        weights.push_back(cur);
-        cur.clear();
+    vector<vector<long double>> in = readInput(argv[2]);
+    vector<vector<long double>> targets = readWeights(argv[3]);
+    vector<vector<long double>> flatWeights = readWeights(argv[4]);
+    vector<structureData*> data = readStructure(argv[5]);
+    string checkpoint = argv[6];
+    int epochs = argc > 7 ? stoi(argv[7]) : 10;
+    int batchSize = argc > 8 ? stoi(argv[8]) : 32;
+    long double rate = argc > 9 ? stold(argv[9]) : 0.1;
+    long double momentum = argc > 10 ? stold(argv[10]) : 0.9;
+    int threads = argc > 11 ? stoi(argv[11]) : max(1u, thread::hardware_concurrency());
+    if (epochs <= 0 || batchSize <= 0 || threads <= 0) {
+        cerr << "Error: epochs, batch size and threads must be at least 1" << endl;
+        cerr << "usage: " << argv[0]
+             << " --train input targets weights structure checkpoint [epochs] [batch size] [rate] [momentum] [threads]"
+             << endl;
+        return 1;
     }
 
-    return weights;
+    CNN net;
+    net.loadWeights(flatWeights, data);
+    Trainer trainer(data, threads);
+
+    for (int e = 1; e <= epochs; e++) {
+        long double loss = trainer.epoch(in, targets, batchSize, rate, momentum);
+        cout << "epoch: " << e << " | loss: " << setprecision(10) << loss << endl;
+        writeWeights(checkpoint + ".weights", flatWeights, data);
+        writeStructure(checkpoint + ".structure", data);
+    }
+    return 0;
 }
-
 /**
  * @brief driver function
  *
@@ -165,6 +76,10 @@ vector<vector<long double>> readWeights(string filename) {
  * @return int
  */
 int main(int argc, char** argv) {
+    if (argc > 1 && string(argv[1]) == "--train") {
+        return train(argc, argv);
+    }
+
     vector<vector<long double>> in = readInput(argv[1]);
     vector<vector<long double>> flatWeights = readWeights(argv[2]);
     vector<structureData*> data = readStructure(argv[3]);
@@ -0,0 +1,313 @@
+/**
+ * @file compiler.cpp
+ * @author Keoni Burns
+ * @brief equivalence check for cnnc. a few structures (per window and sliding pooling, two convolutions, fully
+ * connected layers with tied channels) are compiled three ways: weights embedded in a single translation unit,
+ * weights loaded at runtime, and as a library through --header linked into a separate caller. every build runs the
+ * same inputs as the forward pass CNN::run does and prints its outputs as exact hex floats. the generated code
+ * rescans every pooling window, so it has to match bit for bit unless the interpreted model takes avgSliding, whose
+ * prefix sums can move the last bits, then it has to stay within kTolerance
+ *
+ * build:  g++ -O2 -o cnnc compiler.cpp CNN.cpp && g++ -O2 -o test_compiler tests/compiler.cpp CNN.cpp
+ * usage:  ./test_compiler [cnnc] [c++ compiler]   exits non zero on any failure, writes its scratch files to the
+ *         working directory and removes them afterwards
+ *
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../CNN.h"
+
+using namespace std;
+
+// relative to the largest output, only used for models with a sliding avg pooling layer
+const long double kTolerance = 64 * LDBL_EPSILON;
+const int kSamples = 4;
+
+/**
+ * @brief a model to compile, as the lines of its structure file
+ *
+ */
+struct testModel {
+    string name;
+    vector<string> structure;
+};
+
+/**
+ * @brief writes a file from a string
+ *
+ */
+void spit(string filename, string contents) {
+    ofstream file(filename, ios::out);
+    file << contents;
+}
+
+/**
+ * @brief runs a shell command, prints it when it fails
+ *
+ * @return bool true on success
+ */
+bool shell(string command) {
+    if (system(command.c_str()) != 0) {
+        cout << "  failed: " << command << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief the forward pass of CNN::run for one input, flattened channel by channel
+ *
+ * @param data
+ * @param in
+ * @return vector<long double>
+ */
+vector<long double> reference(vector<structureData *> &data, vector<long double> &in) {
+    CNN net;
+    Matrix x = net.makeF0(in);
+    for (int i = 1; i < data.size(); i++) {
+        x = data[i]->doTheThing(x);
+        if (data[i]->getType() != MAX_POOLING && data[i]->getType() != AVERAGE_POOLING) {
+            x = data[i]->activation(x);
+        }
+    }
+    vector<long double> out;
+    for (auto &channel : x.getVec()) {
+        for (auto &row : channel) {
+            for (auto &col : row) {
+                out.push_back(col);
+            }
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief source of a caller that reads inputs from a file and prints every output of run() as a hex float, one
+ * input per line
+ *
+ * @param name namespace of the generated model
+ * @param include file the caller includes, the generated source itself or its header
+ * @param runtime whether the weights have to be loaded first
+ * @return string
+ */
+string caller(string name, string include, bool runtime) {
+    ostringstream out;
+    out << "#include <stdio.h>\n\n";
+    out << "#include \"" << include << "\"\n\n";
+    out << "int main(int argc, char **argv) {\n";
+    if (runtime) {
+        out << "    if (!" << name << "::loadWeights(argv[2])) {\n";
+        out << "        return 1;\n";
+        out << "    }\n";
+    }
+    out << "    FILE *in = fopen(argv[1], \"r\");\n";
+    out << "    static long double input[" << name << "::kInputSide * " << name << "::kInputSide];\n";
+    out << "    static long double output[" << name << "::kOutputChannels][" << name << "::kOutputSide][" << name
+        << "::kOutputSide];\n";
+    out << "    while (fscanf(in, \"%Lf\", &input[0]) == 1) {\n";
+    out << "        for (int k = 1; k < " << name << "::kInputSide * " << name << "::kInputSide; k++) {\n";
+    out << "            fscanf(in, \"%Lf\", &input[k]);\n";
+    out << "        }\n";
+    out << "        " << name << "::run(input, output);\n";
+    out << "        for (auto &channel : output) {\n";
+    out << "            for (auto &row : channel) {\n";
+    out << "                for (long double col : row) {\n";
+    out << "                    printf(\"%La \", col);\n";
+    out << "                }\n";
+    out << "            }\n";
+    out << "        }\n";
+    out << "        printf(\"\\n\");\n";
+    out << "    }\n";
+    out << "    return 0;\n";
+    out << "}\n";
+    return out.str();
+}
+
+/**
+ * @brief compiles the model one way, runs it over the inputs and compares with the interpreted outputs
+ *
+ * @param model
+ * @param variant embedded, runtime or header
+ * @param cnnc
+ * @param cxx
+ * @param expected
+ * @param exact whether the outputs have to match bit for bit
+ * @return int 1 on failure
+ */
+int checkVariant(testModel &model, string variant, string cnnc, string cxx, vector<vector<long double>> &expected,
+                 bool exact) {
+    string prefix = "test_cnnc_" + model.name + "_" + variant;
+    string name = "net_" + variant;
+    bool runtime = variant == "runtime";
+    string weights = runtime ? "" : " test_cnnc_" + model.name + ".weights";
+    string args = " test_cnnc_" + model.name + ".input" + (runtime ? " test_cnnc_" + model.name + ".weights" : "");
+
+    bool built = false;
+    if (variant == "header") {
+        spit(prefix + "_main.cpp", caller(name, prefix + ".h", false));
+        built = shell(cnnc + " test_cnnc_" + model.name + ".structure" + weights + " -o " + prefix + ".cpp --header " +
+                      prefix + ".h --name " + name) &&
+                shell(cxx + " -c -o " + prefix + ".o " + prefix + ".cpp") &&
+                shell(cxx + " -o " + prefix + " " + prefix + "_main.cpp " + prefix + ".o");
+    } else {
+        spit(prefix + "_main.cpp", caller(name, prefix + ".cpp", runtime));
+        built = shell(cnnc + " test_cnnc_" + model.name + ".structure" + weights + " -o " + prefix + ".cpp --name " +
+                      name) &&
+                shell(cxx + " -o " + prefix + " " + prefix + "_main.cpp");
+    }
+    built = built && shell("./" + prefix + args + " > " + prefix + ".out");
+
+    int failures = built ? 0 : 1;
+    long double worst = 0;
+    ifstream file(prefix + ".out", ios::in);
+    string line;
+    int s = 0;
+    for (; built && s < expected.size() && getline(file, line); s++) {
+        istringstream iss(line);
+        string word;
+        long double scale = 1;
+        for (long double v : expected[s]) {
+            scale = fabsl(v) > scale ? fabsl(v) : scale;
+        }
+        for (int k = 0; k < expected[s].size(); k++) {
+            if (!(iss >> word)) {
+                cout << "  sample " << s << " is missing outputs" << endl;
+                failures++;
+                break;
+            }
+            long double diff = fabsl(strtold(word.c_str(), nullptr) - expected[s][k]) / scale;
+            worst = diff > worst ? diff : worst;
+        }
+    }
+    if (built && s != expected.size()) {
+        cout << "  " << s << " of " << expected.size() << " samples came back" << endl;
+        failures++;
+    }
+    if (exact ? worst != 0 : worst > kTolerance) {
+        failures++;
+    }
+    cout << model.name << " " << variant << ": " << (failures ? "FAILED" : "ok") << ", worst difference "
+         << (double)(worst / LDBL_EPSILON) << " epsilon" << (exact ? ", has to be exact" : "") << endl;
+
+    for (string ext : {".cpp", ".h", ".o", ".out", "_main.cpp", ""}) {
+        remove((prefix + ext).c_str());
+    }
+    return failures;
+}
+
+/**
+ * @brief writes the model's structure, random weights and pixel inputs, then checks all three builds
+ *
+ * @param model
+ * @param cnnc
+ * @param cxx
+ * @param seed
+ * @return int number of failing builds
+ */
+int checkModel(testModel &model, string cnnc, string cxx, int seed) {
+    mt19937 rng(seed);
+    uniform_real_distribution<double> weight(-0.1, 0.1);
+    uniform_int_distribution<int> pixel(0, 255);
+    string prefix = "test_cnnc_" + model.name;
+
+    ostringstream structure;
+    for (string &line : model.structure) {
+        structure << line << "\n";
+    }
+    spit(prefix + ".structure", structure.str());
+
+    // wide enough for any layer here, every row has more values than a layer reads
+    ostringstream weights;
+    weights << setprecision(17);
+    for (int r = 0; r < 64; r++) {
+        for (int k = 0; k < 64; k++) {
+            weights << weight(rng) << " ";
+        }
+        weights << "\n";
+    }
+    spit(prefix + ".weights", weights.str());
+
+    vector<structureData *> data = readStructure(prefix + ".structure");
+    CNN net;
+    net.loadWeights(readWeights(prefix + ".weights"), data);
+    int side = data[0]->getside();
+    bool exact = true;
+    for (structureData *layer : data) {
+        exact = exact && !(layer->getType() == AVERAGE_POOLING &&
+                           useSliding(layer->getFilterSize(), layer->getStride()));
+    }
+
+    ostringstream inputs;
+    vector<vector<long double>> expected;
+    for (int s = 0; s < kSamples; s++) {
+        vector<long double> in(side * side);
+        for (auto &v : in) {
+            v = pixel(rng);
+            inputs << (int)v << " ";
+        }
+        inputs << "\n";
+        expected.push_back(reference(data, in));
+    }
+    spit(prefix + ".input", inputs.str());
+
+    int failures = 0;
+    for (string variant : {"embedded", "runtime", "header"}) {
+        failures += checkVariant(model, variant, cnnc, cxx, expected, exact);
+    }
+    for (string ext : {".structure", ".weights", ".input"}) {
+        remove((prefix + ext).c_str());
+    }
+    return failures;
+}
+
+/**
+ * @brief driver function
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char **argv) {
+    string cnnc = argc > 1 ? argv[1] : "./cnnc";
+    string cxx = argc > 2 ? argv[2] : "g++ -O2";
+
+    vector<testModel> models = {
+        // per window pooling, fully connected with two tied channels
+        {"small",
+         {"0 I 0 0 0 12 1 0 0", "1 C 2 3 1 10 2 0 0.1", "2 M 0 2 2 5 2 0 0", "3 A 0 3 1 3 2 0 0",
+          "4 F 0 0 0 2 2 1 0.2"}},
+        // sliding avg and max pooling, tanh then sigmoid, tied fully connected channels
+        {"sliding",
+         {"0 I 0 0 0 20 1 0 0", "1 C 3 4 1 17 3 1 -0.1", "2 A 0 7 1 11 3 0 0", "3 M 0 6 1 6 3 0 0",
+          "4 F 0 0 0 3 3 0 0.05"}},
+        // two convolutions with strides, pooling with fixed kernels, a single channel fully connected layer
+        {"strided",
+         {"0 I 0 0 0 16 1 0 0", "1 C 2 4 2 7 2 0 0", "2 A 0 5 2 2 2 0 0", "3 C 1 2 1 1 1 1 0.3",
+          "4 F 0 0 0 2 1 0 -0.2"}},
+    };
+
+    int failures = 0;
+    int seed = 1;
+    for (testModel &model : models) {
+        failures += checkModel(model, cnnc, cxx, seed++);
+    }
+
+    if (failures) {
+        cout << "FAILED" << endl;
+        return 1;
+    }
+    cout << "cnnc output matches the interpreted forward pass" << endl;
+    return 0;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file kernels.cpp
+ * @author Keoni Burns
+ * @brief equivalence and timing check for the specialized window kernels. every KERNEL_SHAPES entry and one shape
+ * without a specialized kernel is run through the layers' own forward pass and through convHelper, maxHelper and
+ * avgHelper, the outputs have to be bit identical. only the shapes that have a fixed kernel are timed, the sliding
+ * pooling engines are timed and checked by tests/pooling.cpp instead
+ *
+ * build:  g++ -O2 -o test_kernels tests/kernels.cpp CNN.cpp
+ * usage:  ./test_kernels [repetitions]   exits non zero on any mismatch
+ *
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../CNN.h"
+
+using namespace std;
+
+// input every shape runs over, sized so each shape has plenty of windows
+const int kChannels = 3;
+const int kSide = 64;
+
+// shape with no specialized kernel that still takes the per window path in pooling
+const int kFallbackFilter = 4;
+const int kFallbackStride = 2;
+
+// every timed result is added here and printed at the end so the timed loops can't be optimized away
+long double sink = 0;
+
+/**
+ * @brief runs fn reps times and returns the average time per call in nanoseconds
+ *
+ */
+template <typename Fn>
+double timeIt(int reps, Fn fn) {
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        fn();
+    }
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / reps;
+}
+
+/**
+ * @brief formats a helper and kernel timing pair in microseconds with the speedup
+ *
+ */
+string speedup(double generic, double fast) {
+    ostringstream out;
+    out << fixed << setprecision(2) << generic / 1000 << " -> " << fast / 1000 << " us (" << generic / fast << "x)";
+    return out.str();
+}
+
+/**
+ * @brief compares the layers' forward pass for one shape with the generic helpers and prints the timings of the shape's
+ * fixed kernels
+ *
+ * @param input
+ * @param filterSize
+ * @param stride
+ * @param reps
+ * @return int number of mismatching cells
+ */
+int checkShape(vector<vector<vector<long double>>> &input, int filterSize, int stride, int reps) {
+    int side = ((kSide - filterSize) / stride) + 1;
+    int filters = 2;
+    mt19937 rng(filterSize * 31 + stride);
+    uniform_real_distribution<double> dist(-1, 1);
+
+    Convolution conv(1, CONVOLUTION, filters, filterSize, stride, side, kChannels, 0, 0);
+    for (int f = 0; f < filters; f++) {
+        vector<long double> flat(filterSize * filterSize);
+        for (auto &w : flat) {
+            w = dist(rng);
+        }
+        conv.makeWeights(flat);
+    }
+    MaxPooling maxPool(2, MAX_POOLING, 0, filterSize, stride, side, kChannels, 0, 0);
+    AvgPooling avgPool(3, AVERAGE_POOLING, 0, filterSize, stride, side, kChannels, 0, 0);
+
+    convKernel convFast = findConvKernel(filterSize, stride);
+    poolKernel maxFast = findMaxKernel(filterSize, stride);
+    poolKernel avgFast = findAvgKernel(filterSize, stride);
+    bool sliding = useSliding(filterSize, stride);
+
+    // each layer's own forward pass is compared, so whichever path it dispatched to is what gets checked
+    vector<vector<vector<long double>>> convOut = conv.doTheThing(Matrix(input)).getVec();
+    vector<vector<vector<long double>>> maxOut = maxPool.doTheThing(Matrix(input)).getVec();
+    vector<vector<vector<long double>>> avgOut = avgPool.doTheThing(Matrix(input)).getVec();
+    int mismatches = 0;
+    for (int c = 0; c < filters; c++) {
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                mismatches += convOut[c][i][j] != conv.convHelper(c, i, j, input);
+            }
+        }
+    }
+    for (int c = 0; c < kChannels; c++) {
+        for (int i = 0; i < side; i++) {
+            for (int j = 0; j < side; j++) {
+                // maxSliding is exact too, avgSliding is only checked to a tolerance in tests/pooling.cpp
+                mismatches += maxOut[c][i][j] != maxPool.maxHelper(input, c, i, j);
+                mismatches += !sliding && avgOut[c][i][j] != avgPool.avgHelper(input, c, i, j);
+            }
+        }
+    }
+
+    // timings are per full layer, the generic column calls the helpers the way the layers did before dispatch. a
+    // column is only timed when the shape has a kernel to compare with
+    string convColumn = "no fixed kernel";
+    if (convFast) {
+        double generic = timeIt(reps, [&] {
+            for (int c = 0; c < filters; c++)
+                for (int i = 0; i < side; i++)
+                    for (int j = 0; j < side; j++) sink += conv.convHelper(c, i, j, input);
+        });
+        double fast = timeIt(reps, [&] {
+            for (int c = 0; c < filters; c++)
+                for (int i = 0; i < side; i++)
+                    for (int j = 0; j < side; j++) sink += convFast(input, conv.getWeights()[c], i, j);
+        });
+        convColumn = speedup(generic, fast);
+    }
+    // pooling shapes without a kernel run the sliding engines or the helper, tests/pooling.cpp times those
+    string maxColumn = sliding ? "sliding" : "no fixed kernel";
+    string avgColumn = maxColumn;
+    if (maxFast) {
+        double generic = timeIt(reps, [&] {
+            for (int c = 0; c < kChannels; c++)
+                for (int i = 0; i < side; i++)
+                    for (int j = 0; j < side; j++) sink += maxPool.maxHelper(input, c, i, j);
+        });
+        double fast = timeIt(reps, [&] {
+            for (int c = 0; c < kChannels; c++)
+                for (int i = 0; i < side; i++)
+                    for (int j = 0; j < side; j++) sink += maxFast(input, c, i, j);
+        });
+        maxColumn = speedup(generic, fast);
+    }
+    if (avgFast) {
+        double generic = timeIt(reps, [&] {
+            for (int c = 0; c < kChannels; c++)
+                for (int i = 0; i < side; i++)
+                    for (int j = 0; j < side; j++) sink += avgPool.avgHelper(input, c, i, j);
+        });
+        double fast = timeIt(reps, [&] {
+            for (int c = 0; c < kChannels; c++)
+                for (int i = 0; i < side; i++)
+                    for (int j = 0; j < side; j++) sink += avgFast(input, c, i, j);
+        });
+        avgColumn = speedup(generic, fast);
+    }
+
+    cout << setw(2) << filterSize << "x" << filterSize << "/s" << stride << " | conv " << convColumn << " | max "
+         << maxColumn << " | avg " << avgColumn << (mismatches ? " | MISMATCH" : "") << endl;
+    return mismatches;
+}
+
+/**
+ * @brief driver function
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char **argv) {
+    int reps = argc > 1 ? stoi(argv[1]) : 20;
+    mt19937 rng(7);
+    uniform_real_distribution<double> dist(-1, 1);
+    vector<vector<vector<long double>>> input(kChannels, vector<vector<long double>>(kSide, vector<long double>(kSide)));
+    for (auto &channel : input) {
+        for (auto &row : channel) {
+            for (auto &col : row) {
+                col = dist(rng);
+            }
+        }
+    }
+
+    int mismatches = 0;
+#define CHECK_SHAPE(F, S) mismatches += checkShape(input, F, S, reps);
+    KERNEL_SHAPES(CHECK_SHAPE)
+#undef CHECK_SHAPE
+    // a fixed pooling kernel for a shape the sliding engines take over would never run
+#define CHECK_POOL_SHAPE(F, S)                                                       \
+    if (useSliding(F, S)) {                                                          \
+        cerr << F << "x" << F << "/s" << S << " is a sliding pool shape" << endl;    \
+        mismatches++;                                                                \
+    }
+    POOL_KERNEL_SHAPES(CHECK_POOL_SHAPE)
+#undef CHECK_POOL_SHAPE
+    if (findConvKernel(kFallbackFilter, kFallbackStride) || findMaxKernel(kFallbackFilter, kFallbackStride)) {
+        cerr << "fallback shape has a specialized kernel, pick another one" << endl;
+        return 1;
+    }
+    mismatches += checkShape(input, kFallbackFilter, kFallbackStride, reps);
+
+    if (mismatches) {
+        cout << "FAILED: " << mismatches << " cells differ from the generic helpers" << endl;
+        return 1;
+    }
+    cout << "every layer matches the generic helpers (checksum " << (double)sink << ")" << endl;
+    return 0;
+}
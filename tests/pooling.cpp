@@ -0,0 +1,219 @@
+/**
+ * @file pooling.cpp
+ * @author Keoni Burns
+ * @brief equivalence and timing check for the sliding pooling engines over filter sizes 1-9 and every stride up to
+ * one past the filter size, once with inputs in [-1, 1] and once with 0-255 pixel values. maxSliding has to match
+ * maxHelper bit for bit. avgSliding takes its sums from prefix sums, so it may differ from avgHelper in the last bits,
+ * it has to stay within kAvgTolerance times avgScale. the timings compare each engine with the per window path the
+ * layer would take otherwise, for the shapes around where useSliding switches
+ *
+ * build:  g++ -O2 -o test_pooling tests/pooling.cpp CNN.cpp
+ * usage:  ./test_pooling [repetitions]   exits non zero on any mismatch
+ *
+ */
+
+#include <float.h>
+#include <math.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../CNN.h"
+
+using namespace std;
+
+// epsilons allowed per unit of avgScale. the worst drift seen over this sweep is about 1.5, on the pixel inputs
+const long double kAvgTolerance = 4 * LDBL_EPSILON;
+const int kChannels = 2;
+
+// input the timings run over, the same size tests/kernels.cpp uses
+const int kTimeChannels = 3;
+const int kTimeSide = 64;
+
+// every timed result is added here and printed at the end so the timed loops can't be optimized away
+long double sink = 0;
+
+/**
+ * @brief what the rounding error of avgSliding grows with. the prefix sums along a line reach up to side times the
+ * largest input and lose their low bits to it, the window sums come from differences of those and are divided by
+ * filterSize squared, while the vertical pass adds filterSize rows of them
+ *
+ * @param channel
+ * @param filterSize
+ * @return long double
+ */
+long double avgScale(vector<vector<long double>> &channel, int filterSize) {
+    long double largest = 0;
+    for (auto &row : channel) {
+        for (auto &col : row) {
+            largest = fabsl(col) > largest ? fabsl(col) : largest;
+        }
+    }
+    return largest * channel.size() / filterSize;
+}
+
+/**
+ * @brief runs every shape of the sweep over inputs drawn from dist and compares the sliding engines with the helpers
+ *
+ * @param label
+ * @param dist
+ * @param rng
+ * @return int number of mismatching cells
+ */
+int checkInputs(string label, uniform_real_distribution<long double> dist, mt19937 &rng) {
+    int maxMismatches = 0;
+    int avgMismatches = 0;
+    int avgDiffering = 0;
+    int cells = 0;
+    long double worstAvg = 0;
+
+    for (int filterSize = 1; filterSize <= 9; filterSize++) {
+        for (int stride = 1; stride <= filterSize + 1; stride++) {
+            for (int side : {filterSize, filterSize + 5, 33, 64}) {
+                int outSide = ((side - filterSize) / stride) + 1;
+                // the second term fills the low bits a double would not have
+                vector<vector<vector<long double>>> input(
+                    kChannels, vector<vector<long double>>(side, vector<long double>(side)));
+                for (auto &channel : input) {
+                    for (auto &row : channel) {
+                        for (auto &col : row) {
+                            col = dist(rng) + (dist(rng) * 1e-10L);
+                        }
+                    }
+                }
+
+                MaxPooling maxPool(1, MAX_POOLING, 0, filterSize, stride, outSide, kChannels, 0, 0);
+                AvgPooling avgPool(2, AVERAGE_POOLING, 0, filterSize, stride, outSide, kChannels, 0, 0);
+                vector<vector<long double>> maxes(outSide, vector<long double>(outSide));
+                vector<vector<long double>> avgs(outSide, vector<long double>(outSide));
+
+                for (int c = 0; c < kChannels; c++) {
+                    long double scale = avgScale(input[c], filterSize);
+                    maxPool.maxSliding(input, c, maxes);
+                    avgPool.avgSliding(input, c, avgs);
+                    for (int i = 0; i < outSide; i++) {
+                        for (int j = 0; j < outSide; j++) {
+                            maxMismatches += maxes[i][j] != maxPool.maxHelper(input, c, i, j);
+                            long double diff = fabsl(avgs[i][j] - avgPool.avgHelper(input, c, i, j));
+                            avgMismatches += diff > kAvgTolerance * scale;
+                            avgDiffering += diff != 0;
+                            worstAvg = diff / scale > worstAvg ? diff / scale : worstAvg;
+                            cells++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    cout << label << " max: " << maxMismatches << " of " << cells << " cells differ from maxHelper" << endl;
+    cout << label << " avg: " << avgDiffering << " of " << cells << " cells differ from avgHelper, worst by "
+         << (double)(worstAvg / LDBL_EPSILON) << " epsilon of avgScale, tolerance "
+         << (double)(kAvgTolerance / LDBL_EPSILON) << endl;
+    return maxMismatches + avgMismatches;
+}
+
+/**
+ * @brief runs fn reps times and returns the average time per call in microseconds
+ *
+ */
+template <typename Fn>
+double timeIt(int reps, Fn fn) {
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        fn();
+    }
+    chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / reps;
+}
+
+/**
+ * @brief times one pooling shape through the sliding engines and through the fixed kernel or helper the layer uses
+ * when it is not sliding, marks the engine useSliding picks
+ *
+ * @param input
+ * @param filterSize
+ * @param stride
+ * @param reps
+ */
+void timeShape(vector<vector<vector<long double>>> &input, int filterSize, int stride, int reps) {
+    int side = ((kTimeSide - filterSize) / stride) + 1;
+    MaxPooling maxPool(1, MAX_POOLING, 0, filterSize, stride, side, kTimeChannels, 0, 0);
+    AvgPooling avgPool(2, AVERAGE_POOLING, 0, filterSize, stride, side, kTimeChannels, 0, 0);
+    poolKernel maxFast = findMaxKernel(filterSize, stride);
+    poolKernel avgFast = findAvgKernel(filterSize, stride);
+    vector<vector<long double>> result(side, vector<long double>(side));
+
+    double maxSliding = timeIt(reps, [&] {
+        for (int c = 0; c < kTimeChannels; c++) {
+            maxPool.maxSliding(input, c, result);
+            sink += result[0][0];
+        }
+    });
+    double maxWindow = timeIt(reps, [&] {
+        for (int c = 0; c < kTimeChannels; c++)
+            for (int i = 0; i < side; i++)
+                for (int j = 0; j < side; j++)
+                    sink += maxFast ? maxFast(input, c, i, j) : maxPool.maxHelper(input, c, i, j);
+    });
+    double avgSliding = timeIt(reps, [&] {
+        for (int c = 0; c < kTimeChannels; c++) {
+            avgPool.avgSliding(input, c, result);
+            sink += result[0][0];
+        }
+    });
+    double avgWindow = timeIt(reps, [&] {
+        for (int c = 0; c < kTimeChannels; c++)
+            for (int i = 0; i < side; i++)
+                for (int j = 0; j < side; j++)
+                    sink += avgFast ? avgFast(input, c, i, j) : avgPool.avgHelper(input, c, i, j);
+    });
+
+    cout << setw(2) << filterSize << "x" << filterSize << "/s" << stride
+         << (useSliding(filterSize, stride) ? " sliding" : (maxFast ? " fixed  " : " helper ")) << fixed
+         << setprecision(2) << " | max window " << maxWindow << " us, sliding " << maxSliding << " us ("
+         << maxWindow / maxSliding << "x) | avg window " << avgWindow << " us, sliding " << avgSliding << " us ("
+         << avgWindow / avgSliding << "x)" << endl;
+}
+
+/**
+ * @brief driver function
+ *
+ * @param argc
+ * @param argv
+ * @return int
+ */
+int main(int argc, char **argv) {
+    int reps = argc > 1 ? stoi(argv[1]) : 20;
+    mt19937 rng(3);
+    int mismatches = checkInputs("[-1, 1]", uniform_real_distribution<long double>(-1, 1), rng);
+    mismatches += checkInputs("pixels", uniform_real_distribution<long double>(0, 255), rng);
+
+    vector<vector<vector<long double>>> input(
+        kTimeChannels, vector<vector<long double>>(kTimeSide, vector<long double>(kTimeSide)));
+    uniform_real_distribution<long double> dist(-1, 1);
+    for (auto &channel : input) {
+        for (auto &row : channel) {
+            for (auto &col : row) {
+                col = dist(rng);
+            }
+        }
+    }
+    // from a couple of filter sizes below where each stride switches to a couple past it
+    for (int stride = 1; stride <= 4; stride++) {
+        for (int filterSize = max(2, stride); filterSize <= (3 * stride) + 5; filterSize++) {
+            timeShape(input, filterSize, stride, reps);
+        }
+    }
+
+    if (mismatches) {
+        cout << "FAILED" << endl;
+        return 1;
+    }
+    cout << "sliding pooling engines match the per window helpers (checksum " << (double)sink << ")" << endl;
+    return 0;
+}
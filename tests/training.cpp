@@ -0,0 +1,345 @@
+/**
+ * @file training.cpp
+ * @author Keoni Burns
+ * @brief checks for the training engine. every weight and bias gradient the trainer applies is compared with a
+ * central finite difference of the loss, and runs with the same seed have to write byte identical checkpoints
+ * whatever the thread count. the models cover convolution, max and avg pooling (per window and sliding), fully connected
+ * layers with tied channels, and both activations
+ *
+ * build:  g++ -O2 -pthread -o test_training tests/training.cpp CNN.cpp trainer.cpp
+ * usage:  ./test_training   exits non zero on any failure, writes its checkpoints to the working directory
+ *
+ */
+
+#include <math.h>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../CNN.h"
+#include "../trainer.h"
+
+using namespace std;
+
+// the gradient the trainer applied is recovered from one plain sgd step of this size
+const long double kRate = 1e-6;
+const long double kStep = 1e-7;
+const long double kRelTolerance = 1e-6;
+const long double kAbsTolerance = 1e-9;
+
+/**
+ * @brief one line of a structure file
+ *
+ */
+struct layerSpec {
+    char type;
+    int numFilters;
+    int filterSize;
+    int stride;
+    int matrixDimension;
+    int channels;
+    int activation;
+    double bias;
+};
+
+/**
+ * @brief a model to train, with its weight file rows, inputs and targets
+ *
+ */
+struct testModel {
+    string name;
+    vector<layerSpec> layers;
+    vector<vector<long double>> flatWeights;
+    vector<vector<long double>> in;
+    vector<vector<long double>> targets;
+};
+
+/**
+ * @brief writes the model's structure file and reads it back with readStructure, then loads its weights
+ *
+ * @param model
+ * @return vector<structureData *>
+ */
+vector<structureData *> build(testModel &model) {
+    string filename = "test_training_" + model.name + ".structure";
+    ofstream file(filename, ios::out);
+    // enough digits that the bias reads back as the same double
+    file << setprecision(17);
+    for (int i = 0; i < model.layers.size(); i++) {
+        layerSpec &l = model.layers[i];
+        file << i << " " << l.type << " " << l.numFilters << " " << l.filterSize << " " << l.stride << " "
+             << l.matrixDimension << " " << l.channels << " " << l.activation << " " << l.bias << endl;
+    }
+    file.close();
+
+    vector<structureData *> data = readStructure(filename);
+    remove(filename.c_str());
+    CNN net;
+    net.loadWeights(model.flatWeights, data);
+    return data;
+}
+
+/**
+ * @brief mean loss over the inputs, computed with the plain forward pass rather than the trainer's
+ *
+ * @param data
+ * @param model
+ * @return long double
+ */
+long double meanLoss(vector<structureData *> &data, testModel &model) {
+    CNN net;
+    long double total = 0;
+    for (int s = 0; s < model.in.size(); s++) {
+        Matrix x = net.makeF0(model.in[s]);
+        for (int i = 1; i < data.size(); i++) {
+            x = data[i]->doTheThing(x);
+            if (data[i]->getType() != MAX_POOLING && data[i]->getType() != AVERAGE_POOLING) {
+                x = data[i]->activation(x);
+            }
+        }
+        int k = 0;
+        for (auto &channel : x.getVec()) {
+            for (auto &row : channel) {
+                for (auto &col : row) {
+                    long double diff = col - model.targets[s][k++];
+                    total += 0.5 * diff * diff;
+                }
+            }
+        }
+    }
+    return total / model.in.size();
+}
+
+/**
+ * @brief fills a model with random weights, inputs and targets
+ *
+ * @param name
+ * @param layers
+ * @param samples
+ * @param seed
+ * @return testModel
+ */
+testModel makeModel(string name, vector<layerSpec> layers, int samples, int seed) {
+    mt19937 rng(seed);
+    uniform_real_distribution<long double> weight(-0.1, 0.1);
+    uniform_real_distribution<long double> unit(0, 1);
+    testModel model = {name, layers, {}, {}, {}};
+
+    model.flatWeights.assign(64, vector<long double>(64));
+    for (auto &row : model.flatWeights) {
+        for (auto &w : row) {
+            w = weight(rng);
+        }
+    }
+
+    layerSpec &first = layers.front();
+    layerSpec &last = layers.back();
+    int outputs = (last.type == CONVOLUTION ? last.numFilters : last.channels) * last.matrixDimension *
+                  last.matrixDimension;
+    for (int s = 0; s < samples; s++) {
+        vector<long double> in(first.matrixDimension * first.matrixDimension);
+        for (auto &v : in) {
+            v = unit(rng);
+        }
+        vector<long double> target(outputs);
+        for (auto &v : target) {
+            v = (0.8 * unit(rng)) + 0.1;
+        }
+        model.in.push_back(in);
+        model.targets.push_back(target);
+    }
+    return model;
+}
+
+/**
+ * @brief compares one analytic gradient with its finite difference, prints it when it is off
+ *
+ * @return int 1 on a mismatch
+ */
+int compare(string what, long double analytic, long double numeric) {
+    long double diff = fabsl(analytic - numeric);
+    if (diff > kAbsTolerance + (kRelTolerance * fabsl(numeric))) {
+        cout << "  " << what << ": trainer " << (double)analytic << " finite difference " << (double)numeric << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief one full batch sgd step without momentum gives back the gradient of the mean loss, checked against central
+ * finite differences for every weight and bias
+ *
+ * @param model
+ * @return int number of mismatching gradients
+ */
+int checkGradients(testModel &model) {
+    vector<structureData *> before = build(model);
+    vector<structureData *> after = build(model);
+    Trainer trainer(after, 2);
+    trainer.epoch(model.in, model.targets, model.in.size(), kRate, 0);
+
+    int failures = 0;
+    int checked = 0;
+    for (int l = 1; l < before.size(); l++) {
+        int type = before[l]->getType();
+        if (type != CONVOLUTION && type != FULLY_CONNECTED) {
+            continue;
+        }
+
+        vector<vector<vector<long double>>> &weights = before[l]->getWeights();
+        vector<vector<vector<long double>>> &trained = after[l]->getWeights();
+        // fully connected channels are tied, so only the first one is a free parameter
+        int channels = type == FULLY_CONNECTED ? 1 : weights.size();
+        for (int c = 0; c < channels; c++) {
+            for (int i = 0; i < weights[c].size(); i++) {
+                for (int j = 0; j < weights[c][i].size(); j++) {
+                    long double analytic = (weights[c][i][j] - trained[c][i][j]) / kRate;
+                    long double original = weights[c][i][j];
+                    vector<int> slots = {c};
+                    if (type == FULLY_CONNECTED) {
+                        slots.clear();
+                        for (int s = 0; s < weights.size(); s++) {
+                            slots.push_back(s);
+                        }
+                    }
+
+                    for (int s : slots) weights[s][i][j] = original + kStep;
+                    long double up = meanLoss(before, model);
+                    for (int s : slots) weights[s][i][j] = original - kStep;
+                    long double down = meanLoss(before, model);
+                    for (int s : slots) weights[s][i][j] = original;
+
+                    ostringstream what;
+                    what << "layer " << l << " weight [" << c << "][" << i << "][" << j << "]";
+                    failures += compare(what.str(), analytic, (up - down) / (2 * kStep));
+                    checked++;
+                }
+            }
+        }
+        // tied channels have to stay identical after the update
+        for (int c = 1; c < trained.size() && type == FULLY_CONNECTED; c++) {
+            if (trained[c] != trained[0]) {
+                cout << "  layer " << l << " channel " << c << " drifted from the shared weights" << endl;
+                failures++;
+            }
+        }
+
+        // the bias only lives in the structure, so nudge it by rebuilding the layer
+        long double analytic = (before[l]->getBias() - after[l]->getBias()) / kRate;
+        testModel shifted = model;
+        double upBias = model.layers[l].bias + kStep;
+        double downBias = model.layers[l].bias - kStep;
+        shifted.layers[l].bias = upBias;
+        vector<structureData *> up = build(shifted);
+        shifted.layers[l].bias = downBias;
+        vector<structureData *> down = build(shifted);
+        long double step = (long double)upBias - downBias;
+        failures += compare("layer " + to_string(l) + " bias", analytic,
+                            (meanLoss(up, shifted) - meanLoss(down, shifted)) / step);
+        checked++;
+    }
+
+    cout << model.name << ": " << checked << " gradients checked, " << failures << " off" << endl;
+    return failures;
+}
+
+/**
+ * @brief reads a whole file so checkpoints can be compared byte for byte
+ *
+ */
+string slurp(string filename) {
+    ifstream file(filename, ios::in | ios::binary);
+    ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+/**
+ * @brief trains the model with the same seed on different thread counts, including more threads than shards, the
+ * checkpoints and losses must be identical
+ *
+ * @param model
+ * @return int 1 on failure
+ */
+int checkDeterminism(testModel &model) {
+    vector<int> threadCounts = {1, 3, 4, 4, 40};
+    vector<string> weights;
+    vector<string> structures;
+    vector<long double> losses;
+    for (int threads : threadCounts) {
+        vector<structureData *> data = build(model);
+        Trainer trainer(data, threads, 11);
+        long double loss = 0;
+        for (int e = 0; e < 3; e++) {
+            loss = trainer.epoch(model.in, model.targets, 8, 0.5, 0.9);
+        }
+        string prefix = "test_training_" + model.name + "_" + to_string(weights.size());
+        writeWeights(prefix + ".weights", model.flatWeights, data);
+        writeStructure(prefix + ".structure", data);
+        weights.push_back(slurp(prefix + ".weights"));
+        structures.push_back(slurp(prefix + ".structure"));
+        losses.push_back(loss);
+        remove((prefix + ".weights").c_str());
+        remove((prefix + ".structure").c_str());
+    }
+
+    int failures = 0;
+    for (int r = 1; r < threadCounts.size(); r++) {
+        if (weights[r] != weights[0] || structures[r] != structures[0] || losses[r] != losses[0]) {
+            cout << "  " << threadCounts[r] << " threads differ from 1 thread, loss " << (double)losses[r] << " and "
+                 << (double)losses[0] << endl;
+            failures++;
+        }
+    }
+    cout << model.name << ": determinism " << (failures ? "FAILED" : "ok") << ", loss " << (double)losses[0] << endl;
+    return failures;
+}
+
+/**
+ * @brief driver function
+ *
+ * @return int
+ */
+int main() {
+    vector<testModel> models = {
+        // per window pooling, sigmoid then tanh, fully connected with two tied channels
+        makeModel("small",
+                  {{INPUT, 0, 0, 0, 12, 1, 0, 0},
+                   {CONVOLUTION, 2, 3, 1, 10, 2, 0, 0.1},
+                   {MAX_POOLING, 0, 2, 2, 5, 2, 0, 0},
+                   {AVERAGE_POOLING, 0, 3, 1, 3, 2, 0, 0},
+                   {FULLY_CONNECTED, 0, 0, 0, 2, 2, 1, 0.2}},
+                  32, 1),
+        // sliding pooling, tanh then sigmoid, two convolutions
+        makeModel("sliding",
+                  {{INPUT, 0, 0, 0, 16, 1, 0, 0},
+                   {CONVOLUTION, 3, 4, 1, 13, 3, 1, -0.1},
+                   {MAX_POOLING, 0, 4, 1, 10, 3, 0, 0},
+                   {AVERAGE_POOLING, 0, 5, 1, 6, 3, 0, 0},
+                   {CONVOLUTION, 2, 3, 1, 4, 2, 0, 0.05},
+                   {FULLY_CONNECTED, 0, 0, 0, 2, 1, 0, 0.0}},
+                  32, 2),
+    };
+
+    int failures = 0;
+    for (testModel &model : models) {
+        // finite differences run the whole forward pass per weight, a few inputs are enough
+        testModel few = model;
+        few.in.resize(5);
+        few.targets.resize(5);
+        failures += checkGradients(few);
+        failures += checkDeterminism(model);
+    }
+
+    if (failures) {
+        cout << "FAILED" << endl;
+        return 1;
+    }
+    cout << "training checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "trainer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <vector>
+using namespace std;
+
+Trainer::Trainer(vector<structureData*> data, int threads, int seed) : mrng(seed) {
+    if (threads <= 0) {
+        cerr << "Error: the trainer needs at least one thread, got " << threads << endl;
+        exit(1);
+    }
+    mData = data;
+    mthreads = threads;
+
+    gradients g;
+    for (int i = 0; i < mData.size(); i++) {
+        vector<vector<vector<long double>>> weights = mData[i]->getWeights();
+        if (mData[i]->getType() == FULLY_CONNECTED) {
+            // every channel shares the same weights, Connected::backward only fills the first
+            weights.resize(1);
+        }
+        g.weights.push_back(weights);
+    }
+    g.bias.resize(mData.size());
+    mGradients.assign(kShards, g);
+}
+
+int Trainer::outputSize() {
+    structureData* last = mData.back();
+    int channels = last->getType() == CONVOLUTION ? last->getNumFilters() : last->getChannels();
+    return channels * last->getside() * last->getside();
+}
+
+void Trainer::zero(gradients& g) {
+    for (auto& layer : g.weights) {
+        for (auto& channel : layer) {
+            for (auto& row : channel) {
+                fill(row.begin(), row.end(), 0);
+            }
+        }
+    }
+    fill(g.bias.begin(), g.bias.end(), 0);
+    g.loss = 0;
+}
+
+void Trainer::add(gradients& to, gradients& from) {
+    for (int l = 0; l < to.weights.size(); l++) {
+        for (int c = 0; c < to.weights[l].size(); c++) {
+            for (int i = 0; i < to.weights[l][c].size(); i++) {
+                for (int j = 0; j < to.weights[l][c][i].size(); j++) {
+                    to.weights[l][c][i][j] += from.weights[l][c][i][j];
+                }
+            }
+        }
+        to.bias[l] += from.bias[l];
+    }
+    to.loss += from.loss;
+}
+
+void Trainer::sample(vector<long double>& in, vector<long double>& target, gradients& g) {
+    // forward pass the same way CNN::run does it, keeping every layer's output for the backward pass
+    vector<Matrix> outputs;
+    outputs.push_back(mnet.makeF0(in));
+    for (int i = 1; i < mData.size(); i++) {
+        Matrix output = mData[i]->doTheThing(outputs.back());
+        if (mData[i]->getType() != MAX_POOLING && mData[i]->getType() != AVERAGE_POOLING) {
+            output = mData[i]->activation(output);
+        }
+        outputs.push_back(output);
+    }
+
+    vector<vector<vector<long double>>> result = outputs.back().getVec();
+    int count = 0;
+    for (int c = 0; c < result.size(); c++) {
+        for (int i = 0; i < result[c].size(); i++) {
+            for (int j = 0; j < result[c][i].size(); j++) {
+                long double diff = result[c][i][j] - target[count++];
+                g.loss += 0.5 * diff * diff;
+                result[c][i][j] = diff;
+            }
+        }
+    }
+
+    Matrix grad(result);
+    for (int i = mData.size() - 1; i >= 1; i--) {
+        if (mData[i]->getType() != MAX_POOLING && mData[i]->getType() != AVERAGE_POOLING) {
+            grad = mData[i]->activationBackward(outputs[i], grad);
+            for (auto& channel : grad.getVec()) {
+                for (auto& row : channel) {
+                    for (auto& col : row) {
+                        g.bias[i] += col;
+                    }
+                }
+            }
+        }
+        grad = mData[i]->backward(outputs[i - 1], grad, g.weights[i]);
+    }
+}
+
+void Trainer::shard(vector<vector<long double>>& in, vector<vector<long double>>& targets, vector<int>& order,
+                    int begin, int end, gradients& g) {
+    zero(g);
+    for (int k = begin; k < end; k++) {
+        sample(in[order[k]], targets[order[k]], g);
+    }
+}
+
+void Trainer::work(vector<vector<long double>>& in, vector<vector<long double>>& targets, vector<int>& order,
+                   int start, int end, atomic<int>& next) {
+    int chunk = (end - start + kShards - 1) / kShards;
+    for (int s = next++; s < kShards; s = next++) {
+        int begin = min(end, start + (s * chunk));
+        shard(in, targets, order, begin, min(end, begin + chunk), mGradients[s]);
+    }
+}
+
+long double Trainer::epoch(vector<vector<long double>>& in, vector<vector<long double>>& targets, int batchSize,
+                           long double rate, long double momentum) {
+    if (batchSize <= 0) {
+        cerr << "Error: batch size must be at least 1, got " << batchSize << endl;
+        exit(1);
+    }
+    if (in.empty()) {
+        cerr << "Error: no inputs to train on" << endl;
+        exit(1);
+    }
+    if (in.size() != targets.size()) {
+        cerr << "Error: " << in.size() << " inputs but " << targets.size() << " targets" << endl;
+        exit(1);
+    }
+    for (auto& target : targets) {
+        if (target.size() != outputSize()) {
+            cerr << "Error: each target needs " << outputSize() << " values" << endl;
+            exit(1);
+        }
+    }
+
+    vector<int> order(in.size());
+    iota(order.begin(), order.end(), 0);
+    shuffle(order.begin(), order.end(), mrng);
+
+    long double total = 0;
+    for (int start = 0; start < order.size(); start += batchSize) {
+        int end = min<int>(order.size(), start + batchSize);
+
+        // the shards depend only on the minibatch, threads pull them in turn and this thread works too
+        atomic<int> next(0);
+        vector<thread> workers;
+        for (int t = 1; t < min(mthreads, kShards); t++) {
+            workers.emplace_back(&Trainer::work, this, ref(in), ref(targets), ref(order), start, end, ref(next));
+        }
+        work(in, targets, order, start, end, next);
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        for (int s = 1; s < kShards; s++) {
+            add(mGradients[0], mGradients[s]);
+        }
+
+        total += mGradients[0].loss;
+        for (int i = 1; i < mData.size(); i++) {
+            if (mData[i]->getType() == CONVOLUTION || mData[i]->getType() == FULLY_CONNECTED) {
+                mData[i]->applyGradient(mGradients[0].weights[i], mGradients[0].bias[i], rate / (end - start),
+                                        momentum);
+            }
+        }
+    }
+    return total / in.size();
+}
@@ -0,0 +1,97 @@
+/**
+ * @file trainer.h
+ * @author Keoni Burns
+ * @brief minibatch sgd with momentum over the existing layer types, with the gradient of each minibatch split into a
+ * fixed number of shards that the threads share out
+ *
+ * build:  g++ -O2 -pthread -o cnn main.cpp CNN.cpp trainer.cpp
+ *
+ */
+
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+#include "CNN.h"
+
+using namespace std;
+
+/**
+ * @brief what one shard of a minibatch accumulates
+ *
+ */
+struct gradients {
+    // per layer, shaped like that layer's weights (a single channel for fully connected layers)
+    vector<vector<vector<vector<long double>>>> weights;
+    vector<long double> bias;
+    long double loss;
+};
+
+/**
+ * @brief trains the layers in place. the loss is half the squared error between the last layer's output, flattened
+ * the way Matrix::DisplayInput prints it, and the target line for that input
+ *
+ */
+class Trainer {
+   public:
+    /**
+     * @brief the layers must already hold their weights, see CNN::loadWeights
+     *
+     * @param data
+     * @param threads
+     * @param seed seeds the shuffle, the same seed always gives the same weights whatever the thread count
+     */
+    Trainer(vector<structureData *> data, int threads, int seed = 0);
+
+    /**
+     * @brief one pass over the inputs in a shuffled order, updating the weights after every minibatch. each minibatch
+     * is cut into kShards contiguous shards whose gradients are summed in shard order, so the update does not depend
+     * on how many threads ran them
+     *
+     * @param in
+     * @param targets
+     * @param batchSize
+     * @param rate
+     * @param momentum
+     * @return long double mean loss over the epoch
+     */
+    long double epoch(vector<vector<long double>> &in, vector<vector<long double>> &targets, int batchSize,
+                      long double rate, long double momentum);
+
+    // number of values the last layer outputs, each target line needs exactly this many
+    int outputSize();
+
+   private:
+    // shards per minibatch, more threads than this leave the rest idle
+    static const int kShards = 16;
+
+    /**
+     * @brief forward and backward pass for the inputs order[begin, end), gradients summed into g
+     *
+     */
+    void shard(vector<vector<long double>> &in, vector<vector<long double>> &targets, vector<int> &order, int begin,
+               int end, gradients &g);
+    /**
+     * @brief runs the shards of the minibatch order[start, end) until next runs past the last one
+     *
+     */
+    void work(vector<vector<long double>> &in, vector<vector<long double>> &targets, vector<int> &order, int start,
+              int end, atomic<int> &next);
+    // forward and backward pass for one input
+    void sample(vector<long double> &in, vector<long double> &target, gradients &g);
+    void zero(gradients &g);
+    // adds from into to, always called in shard order so the sum does not depend on scheduling
+    void add(gradients &to, gradients &from);
+
+    vector<structureData *> mData;
+    int mthreads;
+    // one per shard
+    vector<gradients> mGradients;
+    mt19937 mrng;
+    CNN mnet;
+};
+
+#endif